@@ -117,6 +117,23 @@ void MaxRectsBinPack::Insert(std::vector<RectSize> &rects, std::vector<Rect> &ds
 	}
 }
 
+bool MaxRectsBinPack::Place(const Rect &rect)
+{
+	if (rect.x < 0 || rect.y < 0 || rect.x + rect.width > binWidth || rect.y + rect.height > binHeight)
+		return false;
+
+	for(size_t i = 0; i < usedRectangles.size(); ++i)
+	{
+		const Rect &used = usedRectangles[i];
+		if (rect.x < used.x + used.width && used.x < rect.x + rect.width &&
+			rect.y < used.y + used.height && used.y < rect.y + rect.height)
+			return false;
+	}
+
+	PlaceRect(rect);
+	return true;
+}
+
 void MaxRectsBinPack::PlaceRect(const Rect &node)
 {
 	size_t numRectanglesToProcess = freeRectangles.size();
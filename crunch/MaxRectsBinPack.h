@@ -47,6 +47,10 @@ public:
 	/// Inserts a single rectangle into the bin, possibly rotated.
 	Rect Insert(int width, int height, bool rot, FreeRectChoiceHeuristic method);
 
+	/// Places a rectangle at a fixed position, such as where an earlier pack put it.
+	/// @return False if the rectangle is outside the bin or overlaps a rectangle already placed.
+	bool Place(const Rect &rect);
+
 	/// Computes the ratio of used surface area to the total bin area.
 	float Occupancy() const;
 
@@ -0,0 +1,291 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+#include "atlas.hpp"
+#include "binary.hpp"
+#include "perfecthash.hpp"
+#include "crunch_atlas.hpp"
+#include <unordered_set>
+#include <cstring>
+#include <cstddef>
+
+//Sections start on 16 byte boundaries so records can be read in place
+#define SECTION_ALIGNMENT 16
+
+static void PutString(vector<unsigned char>& strings, vector<unsigned char>& buf, const string& str)
+{
+    PutU32(buf, static_cast<uint32_t>(strings.size()));
+    PutU32(buf, static_cast<uint32_t>(str.size()));
+    strings.insert(strings.end(), str.begin(), str.end());
+    strings.push_back(0);
+}
+
+static void SetHeader(vector<unsigned char>& buf, size_t field, size_t value)
+{
+    SetU32(buf, field, static_cast<uint32_t>(value));
+}
+
+bool EncodeAtlasBin(vector<unsigned char>& buf, const string& name, const vector<Packer*>& packers, bool trim, bool rotate, bool* indexed)
+{
+    uint32_t spriteCount = 0;
+    size_t stringsSize = 0;
+    for (size_t i = 0; i < packers.size(); ++i)
+    {
+        spriteCount += static_cast<uint32_t>(packers[i]->bitmaps.size());
+        stringsSize += name.size() + to_string(i).size() + 1;
+        for (const Bitmap* bitmap : packers[i]->bitmaps)
+            stringsSize += bitmap->name.size() + 1;
+    }
+    
+    //Reserve enough for every section (the name index is at most two words
+    //per sprite) so the file is built in one contiguous allocation
+    buf.clear();
+    vector<unsigned char> strings;
+    strings.reserve(stringsSize);
+    buf.reserve(sizeof(crunch::AtlasHeader) + packers.size() * sizeof(crunch::AtlasPage) + spriteCount * (sizeof(crunch::AtlasSprite) + 8) + stringsSize + 4 * 16);
+    buf.resize(sizeof(crunch::AtlasHeader), 0); //filled in once the sections are laid out
+    
+    //Page table
+    uint32_t pageOffset = static_cast<uint32_t>(buf.size());
+    uint32_t firstSprite = 0;
+    for (size_t i = 0; i < packers.size(); ++i)
+    {
+        const Packer* packer = packers[i];
+        PutString(strings, buf, name + to_string(i));
+        PutU32(buf, packer->width);
+        PutU32(buf, packer->height);
+        PutU32(buf, firstSprite);
+        PutU32(buf, static_cast<uint32_t>(packer->bitmaps.size()));
+        firstSprite += static_cast<uint32_t>(packer->bitmaps.size());
+    }
+    
+    //Sprite records, grouped by page
+    Align(buf, SECTION_ALIGNMENT);
+    uint32_t spriteOffset = static_cast<uint32_t>(buf.size());
+    for (size_t i = 0; i < packers.size(); ++i)
+    {
+        const Packer* packer = packers[i];
+        for (size_t j = 0; j < packer->bitmaps.size(); ++j)
+        {
+            const Bitmap* bitmap = packer->bitmaps[j];
+            const Point& point = packer->points[j];
+            PutString(strings, buf, bitmap->name);
+            PutU32(buf, static_cast<uint32_t>(i));
+            PutU32(buf, point.x);
+            PutU32(buf, point.y);
+            PutU32(buf, bitmap->width);
+            PutU32(buf, bitmap->height);
+            PutU32(buf, static_cast<uint32_t>(bitmap->frameX));
+            PutU32(buf, static_cast<uint32_t>(bitmap->frameY));
+            PutU32(buf, bitmap->frameW);
+            PutU32(buf, bitmap->frameH);
+            PutU32(buf, point.rot ? crunch::ATLAS_SPRITE_ROTATED : 0);
+        }
+    }
+    
+    //Name index, a minimal perfect hash from each distinct name to the
+    //first sprite with that name
+    vector<uint64_t> hashes;
+    vector<uint32_t> sprites;
+    unordered_set<string> seen;
+    uint32_t index = 0;
+    for (const Packer* packer : packers)
+    {
+        for (const Bitmap* bitmap : packer->bitmaps)
+        {
+            if (seen.insert(bitmap->name).second)
+            {
+                hashes.push_back(crunch::HashAtlasName(bitmap->name.data(), bitmap->name.size()));
+                sprites.push_back(index);
+            }
+            ++index;
+        }
+    }
+    vector<int32_t> displacements;
+    vector<uint32_t> order;
+    bool built = hashes.empty() || BuildPerfectHash(hashes, displacements, order);
+    if (indexed != nullptr)
+        *indexed = built;
+    
+    Align(buf, SECTION_ALIGNMENT);
+    uint32_t hashOffset = order.empty() ? 0 : static_cast<uint32_t>(buf.size());
+    for (int32_t displacement : displacements)
+        PutU32(buf, static_cast<uint32_t>(displacement));
+    for (uint32_t key : order)
+        PutU32(buf, sprites[key]);
+    
+    //String table, each string is also null terminated
+    Align(buf, SECTION_ALIGNMENT);
+    uint32_t stringOffset = static_cast<uint32_t>(buf.size());
+    buf.insert(buf.end(), strings.begin(), strings.end());
+    Align(buf, SECTION_ALIGNMENT);
+    
+    memcpy(buf.data(), "CRAB", 4);
+    SetHeader(buf, offsetof(crunch::AtlasHeader, version), CRUNCH_ATLAS_VERSION);
+    SetHeader(buf, offsetof(crunch::AtlasHeader, headerSize), sizeof(crunch::AtlasHeader));
+    SetHeader(buf, offsetof(crunch::AtlasHeader, flags), (trim ? crunch::ATLAS_TRIM : 0) | (rotate ? crunch::ATLAS_ROTATE : 0));
+    SetHeader(buf, offsetof(crunch::AtlasHeader, fileSize), buf.size());
+    SetHeader(buf, offsetof(crunch::AtlasHeader, pageCount), packers.size());
+    SetHeader(buf, offsetof(crunch::AtlasHeader, spriteCount), spriteCount);
+    SetHeader(buf, offsetof(crunch::AtlasHeader, pagesOffset), pageOffset);
+    SetHeader(buf, offsetof(crunch::AtlasHeader, spritesOffset), spriteOffset);
+    SetHeader(buf, offsetof(crunch::AtlasHeader, spriteStride), sizeof(crunch::AtlasSprite));
+    SetHeader(buf, offsetof(crunch::AtlasHeader, stringsOffset), stringOffset);
+    SetHeader(buf, offsetof(crunch::AtlasHeader, stringsSize), strings.size());
+    SetHeader(buf, offsetof(crunch::AtlasHeader, hashOffset), hashOffset);
+    SetHeader(buf, offsetof(crunch::AtlasHeader, hashBuckets), displacements.size());
+    SetHeader(buf, offsetof(crunch::AtlasHeader, hashSlots), order.size());
+    
+    return true;
+}
+
+bool SaveAtlasBin(const string& file, const string& name, const vector<Packer*>& packers, bool trim, bool rotate, bool* indexed)
+{
+    vector<unsigned char> buf;
+    return EncodeAtlasBin(buf, name, packers, trim, rotate, indexed) && WriteFile(file, buf);
+}
+
+//Starts a new 16 byte aligned column and records its offset in the header
+static void BeginColumn(vector<unsigned char>& buf, size_t field)
+{
+    Align(buf, SECTION_ALIGNMENT);
+    SetHeader(buf, field, buf.size());
+}
+
+static void PutFloat(vector<unsigned char>& buf, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    PutU32(buf, bits);
+}
+
+bool EncodeAtlasSoa(vector<unsigned char>& buf, const vector<Packer*>& packers)
+{
+    //Flatten the sprites in the same order as the .bin
+    struct Sprite
+    {
+        const Bitmap* bitmap;
+        Point point;
+        uint32_t page;
+    };
+    vector<Sprite> sprites;
+    for (size_t i = 0; i < packers.size(); ++i)
+        for (size_t j = 0; j < packers[i]->bitmaps.size(); ++j)
+            sprites.push_back({ packers[i]->bitmaps[j], packers[i]->points[j], static_cast<uint32_t>(i) });
+    size_t count = sprites.size();
+    
+    buf.clear();
+    buf.reserve(sizeof(crunch::AtlasColumnsHeader) + packers.size() * 8 + count * (10 * 4 + 32) + count / 8 + 13 * SECTION_ALIGNMENT);
+    buf.resize(sizeof(crunch::AtlasColumnsHeader), 0);
+    
+    BeginColumn(buf, offsetof(crunch::AtlasColumnsHeader, pageSizesOffset));
+    for (const Packer* packer : packers)
+    {
+        PutU32(buf, packer->width);
+        PutU32(buf, packer->height);
+    }
+    
+    BeginColumn(buf, offsetof(crunch::AtlasColumnsHeader, pagesOffset));
+    for (const Sprite& s : sprites)
+        PutU32(buf, s.page);
+    BeginColumn(buf, offsetof(crunch::AtlasColumnsHeader, xOffset));
+    for (const Sprite& s : sprites)
+        PutU32(buf, s.point.x);
+    BeginColumn(buf, offsetof(crunch::AtlasColumnsHeader, yOffset));
+    for (const Sprite& s : sprites)
+        PutU32(buf, s.point.y);
+    BeginColumn(buf, offsetof(crunch::AtlasColumnsHeader, widthOffset));
+    for (const Sprite& s : sprites)
+        PutU32(buf, s.bitmap->width);
+    BeginColumn(buf, offsetof(crunch::AtlasColumnsHeader, heightOffset));
+    for (const Sprite& s : sprites)
+        PutU32(buf, s.bitmap->height);
+    BeginColumn(buf, offsetof(crunch::AtlasColumnsHeader, frameXOffset));
+    for (const Sprite& s : sprites)
+        PutU32(buf, static_cast<uint32_t>(s.bitmap->frameX));
+    BeginColumn(buf, offsetof(crunch::AtlasColumnsHeader, frameYOffset));
+    for (const Sprite& s : sprites)
+        PutU32(buf, static_cast<uint32_t>(s.bitmap->frameY));
+    BeginColumn(buf, offsetof(crunch::AtlasColumnsHeader, frameWidthOffset));
+    for (const Sprite& s : sprites)
+        PutU32(buf, s.bitmap->frameW);
+    BeginColumn(buf, offsetof(crunch::AtlasColumnsHeader, frameHeightOffset));
+    for (const Sprite& s : sprites)
+        PutU32(buf, s.bitmap->frameH);
+    
+    BeginColumn(buf, offsetof(crunch::AtlasColumnsHeader, rotatedOffset));
+    for (size_t i = 0; i < count; i += 32)
+    {
+        uint32_t bits = 0;
+        for (size_t j = i; j < i + 32 && j < count; ++j)
+            if (sprites[j].point.rot)
+                bits |= 1u << (j - i);
+        PutU32(buf, bits);
+    }
+    
+    //Corners of the sprite as it appears unrotated. Rotated sprites are
+    //stored turned 90 degrees clockwise, so their top left is at the top right.
+    BeginColumn(buf, offsetof(crunch::AtlasColumnsHeader, uvsOffset));
+    for (const Sprite& s : sprites)
+    {
+        float pw = static_cast<float>(packers[s.page]->width);
+        float ph = static_cast<float>(packers[s.page]->height);
+        float x0 = s.point.x / pw;
+        float y0 = s.point.y / ph;
+        if (s.point.rot)
+        {
+            float x1 = (s.point.x + s.bitmap->height) / pw;
+            float y1 = (s.point.y + s.bitmap->width) / ph;
+            float corners[8] = { x1, y0, x1, y1, x0, y1, x0, y0 };
+            for (float c : corners)
+                PutFloat(buf, c);
+        }
+        else
+        {
+            float x1 = (s.point.x + s.bitmap->width) / pw;
+            float y1 = (s.point.y + s.bitmap->height) / ph;
+            float corners[8] = { x0, y0, x1, y0, x1, y1, x0, y1 };
+            for (float c : corners)
+                PutFloat(buf, c);
+        }
+    }
+    Align(buf, SECTION_ALIGNMENT);
+    
+    memcpy(buf.data(), "CRSA", 4);
+    SetHeader(buf, offsetof(crunch::AtlasColumnsHeader, version), CRUNCH_ATLAS_COLUMNS_VERSION);
+    SetHeader(buf, offsetof(crunch::AtlasColumnsHeader, headerSize), sizeof(crunch::AtlasColumnsHeader));
+    SetHeader(buf, offsetof(crunch::AtlasColumnsHeader, fileSize), buf.size());
+    SetHeader(buf, offsetof(crunch::AtlasColumnsHeader, pageCount), packers.size());
+    SetHeader(buf, offsetof(crunch::AtlasColumnsHeader, spriteCount), count);
+    
+    return true;
+}
+
+bool SaveAtlasSoa(const string& file, const vector<Packer*>& packers)
+{
+    vector<unsigned char> buf;
+    return EncodeAtlasSoa(buf, packers) && WriteFile(file, buf);
+}
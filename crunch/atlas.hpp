@@ -0,0 +1,50 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+#ifndef atlas_hpp
+#define atlas_hpp
+
+#include <string>
+#include <vector>
+#include "packer.hpp"
+
+using namespace std;
+
+//Writes every page and sprite to a version 2 binary atlas, a flat file with
+//fixed size records that a runtime can map into memory and use in place.
+//The layout is defined by crunch_atlas.hpp, which runtimes use to read it.
+//If indexed is given, it is set to whether the name index could be built;
+//without one the file is still valid, but lookups have to search.
+bool EncodeAtlasBin(vector<unsigned char>& buf, const string& name, const vector<Packer*>& packers, bool trim, bool rotate, bool* indexed = nullptr);
+bool SaveAtlasBin(const string& file, const string& name, const vector<Packer*>& packers, bool trim, bool rotate, bool* indexed = nullptr);
+
+//Writes the sprites as a struct of arrays, one array per field plus the
+//normalized uv quad of every sprite, so a renderer can map the file and
+//feed the arrays straight into vertex generation
+bool EncodeAtlasSoa(vector<unsigned char>& buf, const vector<Packer*>& packers);
+bool SaveAtlasSoa(const string& file, const vector<Packer*>& packers);
+
+#endif
@@ -0,0 +1,476 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+#include "bcn.hpp"
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+//Finds the line that best fits the pixels (mean + principal axis) and
+//returns the two points where the pixels project furthest along it
+template <int N>
+static void FitLine(const float (*px)[4], int count, float* e0, float* e1)
+{
+    float mean[N] = {};
+    for (int i = 0; i < count; ++i)
+        for (int c = 0; c < N; ++c)
+            mean[c] += px[i][c];
+    for (int c = 0; c < N; ++c)
+        mean[c] /= count;
+    
+    float cov[N][N] = {};
+    for (int i = 0; i < count; ++i)
+        for (int a = 0; a < N; ++a)
+            for (int b = 0; b < N; ++b)
+                cov[a][b] += (px[i][a] - mean[a]) * (px[i][b] - mean[b]);
+    
+    //Power iteration for the principal axis
+    float axis[N];
+    for (int c = 0; c < N; ++c)
+        axis[c] = 1.0f;
+    for (int iter = 0; iter < 8; ++iter)
+    {
+        float next[N] = {};
+        float len = 0.0f;
+        for (int a = 0; a < N; ++a)
+        {
+            for (int b = 0; b < N; ++b)
+                next[a] += cov[a][b] * axis[b];
+            len = max(len, fabs(next[a]));
+        }
+        if (len < 1e-6f)
+            break;
+        for (int c = 0; c < N; ++c)
+            axis[c] = next[c] / len;
+    }
+    
+    float tmin = 0.0f, tmax = 0.0f;
+    float axisLen = 0.0f;
+    for (int c = 0; c < N; ++c)
+        axisLen += axis[c] * axis[c];
+    if (axisLen > 0.0f)
+    {
+        tmin = 1e30f;
+        tmax = -1e30f;
+        for (int i = 0; i < count; ++i)
+        {
+            float t = 0.0f;
+            for (int c = 0; c < N; ++c)
+                t += (px[i][c] - mean[c]) * axis[c];
+            t /= axisLen;
+            tmin = min(tmin, t);
+            tmax = max(tmax, t);
+        }
+    }
+    for (int c = 0; c < N; ++c)
+    {
+        e0[c] = min(255.0f, max(0.0f, mean[c] + axis[c] * tmin));
+        e1[c] = min(255.0f, max(0.0f, mean[c] + axis[c] * tmax));
+    }
+}
+
+//Least squares refit of the endpoints for the given interpolation weights
+template <int N>
+static bool RefitLine(const float (*px)[4], const float* weights, int count, float* e0, float* e1)
+{
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float x[N] = {}, y[N] = {};
+    for (int i = 0; i < count; ++i)
+    {
+        float w = weights[i];
+        float iw = 1.0f - w;
+        aa += iw * iw;
+        ab += iw * w;
+        bb += w * w;
+        for (int c = 0; c < N; ++c)
+        {
+            x[c] += iw * px[i][c];
+            y[c] += w * px[i][c];
+        }
+    }
+    float det = aa * bb - ab * ab;
+    if (fabs(det) < 1e-6f)
+        return false;
+    for (int c = 0; c < N; ++c)
+    {
+        e0[c] = min(255.0f, max(0.0f, (bb * x[c] - ab * y[c]) / det));
+        e1[c] = min(255.0f, max(0.0f, (aa * y[c] - ab * x[c]) / det));
+    }
+    return true;
+}
+
+static inline float Dist3(const float* a, const float* b)
+{
+    float r = a[0] - b[0], g = a[1] - b[1], bl = a[2] - b[2];
+    return r * r + g * g + bl * bl;
+}
+
+//BC1 color block ------------------------------------------------------------
+
+static inline uint16_t Pack565(const float* c)
+{
+    int r = static_cast<int>(c[0] * 31.0f / 255.0f + 0.5f);
+    int g = static_cast<int>(c[1] * 63.0f / 255.0f + 0.5f);
+    int b = static_cast<int>(c[2] * 31.0f / 255.0f + 0.5f);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static inline void Unpack565(uint16_t v, float* c)
+{
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    c[0] = static_cast<float>((r << 3) | (r >> 2));
+    c[1] = static_cast<float>((g << 2) | (g >> 4));
+    c[2] = static_cast<float>((b << 3) | (b >> 2));
+}
+
+//Picks indices for a pair of 565 endpoints, returning the total error
+static float AssignColorIndices(const float (*px)[4], const bool* opaque, uint16_t c0, uint16_t c1, bool fourColor, uint32_t* indices)
+{
+    float pal[4][3];
+    Unpack565(c0, pal[0]);
+    Unpack565(c1, pal[1]);
+    int colors = fourColor ? 4 : 3;
+    for (int c = 0; c < 3; ++c)
+    {
+        if (fourColor)
+        {
+            pal[2][c] = (2.0f * pal[0][c] + pal[1][c]) / 3.0f;
+            pal[3][c] = (pal[0][c] + 2.0f * pal[1][c]) / 3.0f;
+        }
+        else
+            pal[2][c] = (pal[0][c] + pal[1][c]) * 0.5f;
+    }
+    
+    float error = 0.0f;
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        uint32_t best = 3;
+        if (opaque[i])
+        {
+            float bestDist = 1e30f;
+            for (int j = 0; j < colors; ++j)
+            {
+                float d = Dist3(px[i], pal[j]);
+                if (d < bestDist)
+                {
+                    bestDist = d;
+                    best = j;
+                }
+            }
+            error += bestDist;
+        }
+        bits |= best << (i * 2);
+    }
+    *indices = bits;
+    return error;
+}
+
+static void EncodeColorBlock(const unsigned char* block, unsigned char* out, bool allowAlpha)
+{
+    float px[16][4];
+    bool opaque[16];
+    float fit[16][4];
+    int count = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int c = 0; c < 4; ++c)
+            px[i][c] = block[i * 4 + c];
+        opaque[i] = !allowAlpha || block[i * 4 + 3] >= 128;
+        if (opaque[i])
+            memcpy(fit[count++], px[i], sizeof(px[i]));
+    }
+    
+    uint16_t c0 = 0, c1 = 0;
+    uint32_t indices = 0xffffffff;
+    bool fourColor = count == 16;
+    if (count > 0)
+    {
+        float e0[4], e1[4];
+        FitLine<3>(fit, count, e0, e1);
+        c0 = Pack565(e1);
+        c1 = Pack565(e0);
+        float error = AssignColorIndices(px, opaque, c0, c1, fourColor, &indices);
+        
+        //Refine the endpoints once against the chosen indices
+        static const float weights4[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+        static const float weights3[4] = { 0.0f, 1.0f, 0.5f, 0.0f };
+        float w[16];
+        int n = 0;
+        for (int i = 0; i < 16; ++i)
+            if (opaque[i])
+                w[n++] = (fourColor ? weights4 : weights3)[(indices >> (i * 2)) & 3];
+        if (RefitLine<3>(fit, w, count, e0, e1))
+        {
+            uint16_t r0 = Pack565(e0), r1 = Pack565(e1);
+            uint32_t refined;
+            float refinedError = AssignColorIndices(px, opaque, r0, r1, fourColor, &refined);
+            if (refinedError < error)
+            {
+                c0 = r0;
+                c1 = r1;
+                indices = refined;
+            }
+        }
+    }
+    
+    //Endpoint order selects the mode: c0 > c1 is four color, c0 <= c1 three color
+    if ((fourColor && c0 < c1) || (!fourColor && c0 > c1))
+    {
+        swap(c0, c1);
+        uint32_t swapped = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            uint32_t idx = (indices >> (i * 2)) & 3;
+            if (idx < 2)
+                idx ^= 1;
+            else if (fourColor)
+                idx ^= 1;
+            swapped |= idx << (i * 2);
+        }
+        indices = swapped;
+    }
+    if (fourColor && c0 == c1)
+        indices = 0;
+    
+    out[0] = static_cast<unsigned char>(c0 & 0xff);
+    out[1] = static_cast<unsigned char>(c0 >> 8);
+    out[2] = static_cast<unsigned char>(c1 & 0xff);
+    out[3] = static_cast<unsigned char>(c1 >> 8);
+    for (int i = 0; i < 4; ++i)
+        out[4 + i] = static_cast<unsigned char>(indices >> (i * 8));
+}
+
+//BC4 alpha block --------------------------------------------------------------
+
+static void EncodeAlphaBlock(const unsigned char* block, unsigned char* out)
+{
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; ++i)
+    {
+        a0 = max(a0, static_cast<int>(block[i * 4 + 3]));
+        a1 = min(a1, static_cast<int>(block[i * 4 + 3]));
+    }
+    out[0] = static_cast<unsigned char>(a0);
+    out[1] = static_cast<unsigned char>(a1);
+    
+    uint64_t bits = 0;
+    if (a0 > a1)
+    {
+        int pal[8];
+        pal[0] = a0;
+        pal[1] = a1;
+        for (int i = 2; i < 8; ++i)
+            pal[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+        for (int i = 0; i < 16; ++i)
+        {
+            int a = block[i * 4 + 3];
+            int best = 0, bestDist = 256;
+            for (int j = 0; j < 8; ++j)
+            {
+                int d = abs(a - pal[j]);
+                if (d < bestDist)
+                {
+                    bestDist = d;
+                    best = j;
+                }
+            }
+            bits |= static_cast<uint64_t>(best) << (i * 3);
+        }
+    }
+    for (int i = 0; i < 6; ++i)
+        out[2 + i] = static_cast<unsigned char>(bits >> (i * 8));
+}
+
+void EncodeBc1(const unsigned char* block, unsigned char* out)
+{
+    EncodeColorBlock(block, out, true);
+}
+
+void EncodeBc3(const unsigned char* block, unsigned char* out)
+{
+    EncodeAlphaBlock(block, out);
+    EncodeColorBlock(block, out + 8, false);
+}
+
+//BC7 mode 6: one subset, RGBA 7.7.7.7 endpoints with a p-bit each, 4-bit indices
+
+static const int bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct Bc7Endpoints
+{
+    int q[2][4]; //7-bit values
+    int p[2];
+    int e[2][4]; //expanded 8-bit values
+};
+
+static void QuantizeBc7(const float* e, int p, int* q, int* expanded)
+{
+    for (int c = 0; c < 4; ++c)
+    {
+        int v = static_cast<int>((e[c] - p) / 2.0f + 0.5f);
+        q[c] = min(127, max(0, v));
+        expanded[c] = (q[c] << 1) | p;
+    }
+}
+
+static float AssignBc7Indices(const float (*px)[4], const Bc7Endpoints& ep, int* indices)
+{
+    float pal[16][4];
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 4; ++c)
+            pal[i][c] = static_cast<float>(((64 - bc7Weights[i]) * ep.e[0][c] + bc7Weights[i] * ep.e[1][c] + 32) >> 6);
+    
+    float dir[4], len = 0.0f;
+    for (int c = 0; c < 4; ++c)
+    {
+        dir[c] = static_cast<float>(ep.e[1][c] - ep.e[0][c]);
+        len += dir[c] * dir[c];
+    }
+    
+    float error = 0.0f;
+    for (int i = 0; i < 16; ++i)
+    {
+        //Project onto the endpoint line, then check the neighbouring weights
+        int guess = 0;
+        if (len > 0.0f)
+        {
+            float t = 0.0f;
+            for (int c = 0; c < 4; ++c)
+                t += (px[i][c] - ep.e[0][c]) * dir[c];
+            guess = static_cast<int>(t / len * 15.0f + 0.5f);
+            guess = min(15, max(0, guess));
+        }
+        int best = guess;
+        float bestDist = 1e30f;
+        for (int j = max(0, guess - 1); j <= min(15, guess + 1); ++j)
+        {
+            float d = 0.0f;
+            for (int c = 0; c < 4; ++c)
+                d += (px[i][c] - pal[j][c]) * (px[i][c] - pal[j][c]);
+            if (d < bestDist)
+            {
+                bestDist = d;
+                best = j;
+            }
+        }
+        indices[i] = best;
+        error += bestDist;
+    }
+    return error;
+}
+
+static float FindBc7Endpoints(const float (*px)[4], const float* e0, const float* e1, Bc7Endpoints& best, int* bestIndices)
+{
+    float bestError = 1e30f;
+    for (int p0 = 0; p0 < 2; ++p0)
+    {
+        for (int p1 = 0; p1 < 2; ++p1)
+        {
+            Bc7Endpoints ep;
+            ep.p[0] = p0;
+            ep.p[1] = p1;
+            QuantizeBc7(e0, p0, ep.q[0], ep.e[0]);
+            QuantizeBc7(e1, p1, ep.q[1], ep.e[1]);
+            int indices[16];
+            float error = AssignBc7Indices(px, ep, indices);
+            if (error < bestError)
+            {
+                bestError = error;
+                best = ep;
+                memcpy(bestIndices, indices, sizeof(indices));
+            }
+        }
+    }
+    return bestError;
+}
+
+struct BitWriter
+{
+    unsigned char* out;
+    int pos;
+    void Write(uint32_t value, int bits)
+    {
+        for (int i = 0; i < bits; ++i, ++pos)
+            if ((value >> i) & 1)
+                out[pos >> 3] |= static_cast<unsigned char>(1 << (pos & 7));
+    }
+};
+
+void EncodeBc7(const unsigned char* block, unsigned char* out)
+{
+    float px[16][4];
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 4; ++c)
+            px[i][c] = block[i * 4 + c];
+    
+    float e0[4], e1[4];
+    FitLine<4>(px, 16, e0, e1);
+    
+    Bc7Endpoints ep;
+    int indices[16];
+    float error = FindBc7Endpoints(px, e0, e1, ep, indices);
+    
+    float w[16];
+    for (int i = 0; i < 16; ++i)
+        w[i] = bc7Weights[indices[i]] / 64.0f;
+    if (RefitLine<4>(px, w, 16, e0, e1))
+    {
+        Bc7Endpoints refined;
+        int refinedIndices[16];
+        if (FindBc7Endpoints(px, e0, e1, refined, refinedIndices) < error)
+        {
+            ep = refined;
+            memcpy(indices, refinedIndices, sizeof(indices));
+        }
+    }
+    
+    //The anchor index has an implicit zero high bit, so flip the line if needed
+    if (indices[0] >= 8)
+    {
+        swap(ep.q[0], ep.q[1]);
+        swap(ep.p[0], ep.p[1]);
+        for (int i = 0; i < 16; ++i)
+            indices[i] = 15 - indices[i];
+    }
+    
+    memset(out, 0, 16);
+    BitWriter bits = { out, 0 };
+    bits.Write(1 << 6, 7);
+    for (int c = 0; c < 4; ++c)
+    {
+        bits.Write(ep.q[0][c], 7);
+        bits.Write(ep.q[1][c], 7);
+    }
+    bits.Write(ep.p[0], 1);
+    bits.Write(ep.p[1], 1);
+    bits.Write(indices[0], 3);
+    for (int i = 1; i < 16; ++i)
+        bits.Write(indices[i], 4);
+}
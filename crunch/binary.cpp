@@ -28,20 +28,20 @@
 #include <iostream>
 #include <cstdint>
 
-void WriteString(ofstream& bin, const string& value)
+void WriteString(vector<unsigned char>& bin, const string& value)
 {
-    bin.write(value.data(), value.length() + 1);
+    bin.insert(bin.end(), value.begin(), value.end());
+    bin.push_back(0);
 }
 
-void WriteShort(ofstream& bin, int16_t value)
+void WriteShort(vector<unsigned char>& bin, int16_t value)
 {
-    bin.put(static_cast<uint8_t>(value & 0xff));
-    bin.put(static_cast<uint8_t>((value >> 8) & 0xff));
+    PutU16(bin, static_cast<uint16_t>(value));
 }
 
-void WriteByte(ofstream& bin, char value)
+void WriteByte(vector<unsigned char>& bin, char value)
 {
-    bin.write(&value, 1);
+    PutU8(bin, static_cast<unsigned char>(value));
 }
 
 string ReadString(ifstream& bin)
@@ -60,3 +60,46 @@ int16_t ReadShort(ifstream& bin)
     bin.read(reinterpret_cast<char*>(&value), 2);
     return value;
 }
+
+void PutU8(vector<unsigned char>& buf, uint32_t v)
+{
+    buf.push_back(static_cast<unsigned char>(v));
+}
+
+void PutU16(vector<unsigned char>& buf, uint32_t v)
+{
+    PutU8(buf, v & 0xff);
+    PutU8(buf, (v >> 8) & 0xff);
+}
+
+void PutU32(vector<unsigned char>& buf, uint32_t v)
+{
+    PutU16(buf, v & 0xffff);
+    PutU16(buf, v >> 16);
+}
+
+void SetU32(vector<unsigned char>& buf, size_t pos, uint32_t v)
+{
+    for (int i = 0; i < 4; ++i)
+        buf[pos + i] = static_cast<unsigned char>(v >> (i * 8));
+}
+
+void SetU64(vector<unsigned char>& buf, size_t pos, uint64_t v)
+{
+    SetU32(buf, pos, static_cast<uint32_t>(v));
+    SetU32(buf, pos + 4, static_cast<uint32_t>(v >> 32));
+}
+
+void Align(vector<unsigned char>& buf, size_t alignment)
+{
+    while (buf.size() % alignment != 0)
+        buf.push_back(0);
+}
+
+bool WriteFile(const string& file, const vector<unsigned char>& buf)
+{
+    ofstream stream(file, ios::binary);
+    stream.write(reinterpret_cast<const char*>(buf.data()), buf.size());
+    stream.close();
+    return !stream.fail();
+}
@@ -29,13 +29,24 @@
 
 #include <fstream>
 #include <string>
+#include <vector>
+#include <cstdint>
 
 using namespace std;
 
-void WriteString(ofstream& bin, const string& value);
-void WriteShort(ofstream& bin, int16_t value);
-void WriteByte(ofstream& bin, char value);
+void WriteString(vector<unsigned char>& bin, const string& value);
+void WriteShort(vector<unsigned char>& bin, int16_t value);
+void WriteByte(vector<unsigned char>& bin, char value);
 string ReadString(ifstream& bin);
 int16_t ReadShort(ifstream& bin);
 
+//Little-endian helpers for building a file in memory
+void PutU8(vector<unsigned char>& buf, uint32_t v);
+void PutU16(vector<unsigned char>& buf, uint32_t v);
+void PutU32(vector<unsigned char>& buf, uint32_t v);
+void SetU32(vector<unsigned char>& buf, size_t pos, uint32_t v);
+void SetU64(vector<unsigned char>& buf, size_t pos, uint64_t v);
+void Align(vector<unsigned char>& buf, size_t alignment);
+bool WriteFile(const string& file, const vector<unsigned char>& buf);
+
 #endif
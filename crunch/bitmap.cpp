@@ -26,35 +26,115 @@
 
 #include "bitmap.hpp"
 #include <iostream>
-#define LODEPNG_NO_COMPILE_CPP
 #include "lodepng.h"
 #include <algorithm>
+#include <cstring>
 #include "hash.hpp"
+#include "qoi.hpp"
+#include "palette.hpp"
+#include "binary.hpp"
 
 using namespace std;
 
-Bitmap::Bitmap(const string& file, const string& name, bool premultiply, bool trim)
-: name(name)
+static bool HasExtension(const string& file, const string& ext)
+{
+    return file.size() >= ext.size() && file.compare(file.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+bool IsBitmapExtension(const string& ext)
+{
+    return ext == "png" || ext == "qoi";
+}
+
+bool LoadPixels(const string& file, uint32_t** pixels, int* w, int* h)
 {
-    //Load the png file
     unsigned char* pdata;
     unsigned int pw, ph;
-    if (lodepng_decode32_file(&pdata, &pw, &ph, file.data()))
+    if (HasExtension(file, ".qoi"))
     {
-        cerr << "failed to load png: " << file << endl;
-        exit(EXIT_FAILURE);
+        if (!LoadQoi(file, &pdata, &pw, &ph))
+            return false;
     }
-    int w = static_cast<int>(pw);
-    int h = static_cast<int>(ph);
-    uint32_t* pixels = reinterpret_cast<uint32_t*>(pdata);
+    else if (lodepng_decode32_file(&pdata, &pw, &ph, file.data()))
+        return false;
+    *pixels = reinterpret_cast<uint32_t*>(pdata);
+    *w = static_cast<int>(pw);
+    *h = static_cast<int>(ph);
+    return true;
+}
+
+#define PIXEL_FRAME_MAX_NAME 4096
+#define PIXEL_FRAME_MAX_SIZE 65536
+
+static bool ReadU32(istream& stream, uint32_t& value)
+{
+    unsigned char bytes[4];
+    if (!stream.read(reinterpret_cast<char*>(bytes), 4))
+        return false;
+    value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+    return true;
+}
+
+bool ReadPixelFrame(istream& stream, string& name, uint32_t** pixels, int* w, int* h)
+{
+    uint32_t length, width, height;
+    if (!ReadU32(stream, length) || length > PIXEL_FRAME_MAX_NAME)
+        return false;
+    name.resize(length);
+    if (length > 0 && !stream.read(&name[0], length))
+        return false;
+    if (!ReadU32(stream, width) || !ReadU32(stream, height))
+        return false;
+    if (width == 0 || height == 0 || width > PIXEL_FRAME_MAX_SIZE || height > PIXEL_FRAME_MAX_SIZE)
+        return false;
     
+    //The pixels are read straight into place, RGBA bytes are already the layout Bitmap uses
+    size_t size = sizeof(uint32_t) * static_cast<size_t>(width) * height;
+    uint32_t* data = static_cast<uint32_t*>(malloc(size));
+    if (data == nullptr)
+        return false;
+    if (!stream.read(reinterpret_cast<char*>(data), size))
+    {
+        free(data);
+        return false;
+    }
+    *pixels = data;
+    *w = static_cast<int>(width);
+    *h = static_cast<int>(height);
+    return true;
+}
+
+Bitmap::Bitmap(const string& file, const string& name, bool premultiply, bool trim)
+: name(name), width(0), height(0), frameX(0), frameY(0), frameW(0), frameH(0), data(nullptr), hashValue(0)
+{
+    //Load the png or qoi file
+    uint32_t* pixels;
+    int w, h;
+    if (!LoadPixels(file, &pixels, &w, &h))
+    {
+        cerr << "failed to load " << (HasExtension(file, ".qoi") ? "qoi: " : "png: ") << file << endl;
+        return;
+    }
+    if (!Init(pixels, w, h, premultiply, trim))
+        cout << "image is completely transparent: " << file << endl;
+}
+
+//Takes over pixels, which have to be allocated with malloc
+Bitmap::Bitmap(uint32_t* pixels, int width, int height, const string& name, bool premultiply, bool trim)
+: name(name)
+{
+    Init(pixels, width, height, premultiply, trim);
+}
+
+bool Bitmap::Init(uint32_t* pixels, int w, int h, bool premultiply, bool trim)
+{
     //Premultiply all the pixels by their alpha
     if (premultiply)
     {
-        int count = w * h;
+        size_t count = size_t(w) * h;
         uint32_t c,a,r,g,b;
         float m;
-        for (int i = 0; i < count; ++i)
+        for (size_t i = 0; i < count; ++i)
         {
 			c = pixels[i];
 			a = c >> 24;
@@ -73,6 +153,7 @@ Bitmap::Bitmap(const string& file, const string& name, bool premultiply, bool tr
     int minY = h - 1;
     int maxX = 0;
     int maxY = 0;
+    bool visible = true;
     if (trim)
     {
         uint32_t p;
@@ -80,7 +161,7 @@ Bitmap::Bitmap(const string& file, const string& name, bool premultiply, bool tr
         {
             for (int x = 0; x < w; ++x)
             {
-                p = pixels[y * w + x];
+                p = pixels[size_t(y) * w + x];
                 if ((p >> 24) > 0)
                 {
                     minX = min(x, minX);
@@ -96,7 +177,7 @@ Bitmap::Bitmap(const string& file, const string& name, bool premultiply, bool tr
             minY = 0;
             maxX = w - 1;
             maxY = h - 1;
-            cout << "image is completely transparent: " << file << endl;
+            visible = false;
         }
     }
     else
@@ -123,30 +204,68 @@ Bitmap::Bitmap(const string& file, const string& name, bool premultiply, bool tr
     else
     {
         //Create the trimmed image data
-        data = reinterpret_cast<uint32_t*>(calloc(width * height, sizeof(uint32_t)));
+        data = reinterpret_cast<uint32_t*>(calloc(size_t(width) * height, sizeof(uint32_t)));
         frameX = -minX;
         frameY = -minY;
         
         //Copy trimmed pixels over to the trimmed pixel array
         for (int y = minY; y <= maxY; ++y)
             for (int x = minX; x <= maxX; ++x)
-                data[(y - minY) * width + (x - minX)] = pixels[y * w + x];
+                data[size_t(y - minY) * width + (x - minX)] = pixels[size_t(y) * w + x];
         
         //Free the untrimmed pixels
         free(pixels);
     }
     
-    //Generate a hash for the bitmap
+    UpdateHash();
+    return visible;
+}
+
+void Bitmap::UpdateHash()
+{
     hashValue = 0;
     HashCombine(hashValue, static_cast<size_t>(width));
     HashCombine(hashValue, static_cast<size_t>(height));
     HashData(hashValue, reinterpret_cast<char*>(data), sizeof(uint32_t) * width * height);
 }
 
+void Bitmap::AlignTrim(int multiple)
+{
+    //Widen the trimmed rect to the nearest multiples inside the frame
+    int left = -frameX;
+    int top = -frameY;
+    int alignedLeft = left / multiple * multiple;
+    int alignedTop = top / multiple * multiple;
+    int alignedRight = min((left + width + multiple - 1) / multiple * multiple, frameW);
+    int alignedBottom = min((top + height + multiple - 1) / multiple * multiple, frameH);
+    int w = alignedRight - alignedLeft;
+    int h = alignedBottom - alignedTop;
+    if (w == width && h == height)
+        return;
+    
+    uint32_t* aligned = reinterpret_cast<uint32_t*>(calloc(size_t(w) * h, sizeof(uint32_t)));
+    for (int y = 0; y < height; ++y)
+        memcpy(aligned + size_t(top - alignedTop + y) * w + (left - alignedLeft), data + size_t(y) * width, sizeof(uint32_t) * width);
+    free(data);
+    data = aligned;
+    width = w;
+    height = h;
+    frameX = -alignedLeft;
+    frameY = -alignedTop;
+    UpdateHash();
+}
+
 Bitmap::Bitmap(int width, int height)
 : width(width), height(height)
 {
-    data = reinterpret_cast<uint32_t*>(calloc(width * height, sizeof(uint32_t)));
+    data = reinterpret_cast<uint32_t*>(calloc(size_t(width) * height, sizeof(uint32_t)));
+}
+
+Bitmap::Bitmap(const Bitmap& bitmap, const string& name)
+: name(name), width(bitmap.width), height(bitmap.height), frameX(bitmap.frameX), frameY(bitmap.frameY), frameW(bitmap.frameW), frameH(bitmap.frameH), hashValue(bitmap.hashValue)
+{
+    data = reinterpret_cast<uint32_t*>(malloc(sizeof(uint32_t) * width * height));
+    memcpy(data, bitmap.data, sizeof(uint32_t) * width * height);
 }
 
 Bitmap::~Bitmap()
@@ -154,23 +273,63 @@ Bitmap::~Bitmap()
     free(data);
 }
 
-void Bitmap::SaveAs(const string& file)
+//Encodes an 8-bit indexed png, quantizing if there are more than 256 colors
+static bool EncodePalettePng(vector<unsigned char>& png, const uint32_t* pixels, unsigned w, unsigned h)
+{
+    vector<uint32_t> palette;
+    vector<unsigned char> indices;
+    BuildPalette(pixels, size_t(w) * h, 256, palette);
+    MapToPalette(pixels, size_t(w) * h, palette, indices);
+    
+    lodepng::State state;
+    state.encoder.auto_convert = 0;
+    state.info_raw.colortype = LCT_PALETTE;
+    state.info_raw.bitdepth = 8;
+    state.info_png.color.colortype = LCT_PALETTE;
+    state.info_png.color.bitdepth = 8;
+    for (uint32_t c : palette)
+    {
+        unsigned char r = c & 0xff, g = (c >> 8) & 0xff, b = (c >> 16) & 0xff, a = c >> 24;
+        lodepng_palette_add(&state.info_raw, r, g, b, a);
+        lodepng_palette_add(&state.info_png.color, r, g, b, a);
+    }
+    
+    return lodepng::encode(png, indices.data(), w, h, state) == 0;
+}
+
+bool Bitmap::Encode(vector<unsigned char>& out, bool qoi, bool palette) const
 {
     unsigned char* pdata = reinterpret_cast<unsigned char*>(data);
     unsigned int pw = static_cast<unsigned int>(width);
     unsigned int ph = static_cast<unsigned int>(height);
-    if (lodepng_encode32_file(file.data(), pdata, pw, ph))
+    out.clear();
+    if (qoi)
+    {
+        QoiEncode(out, pdata, pw, ph);
+        return true;
+    }
+    if (palette)
+        return EncodePalettePng(out, data, pw, ph);
+    return lodepng::encode(out, pdata, pw, ph) == 0;
+}
+
+bool Bitmap::SaveAs(const string& file, bool palette)
+{
+    bool qoi = HasExtension(file, ".qoi");
+    vector<unsigned char> buf;
+    if (!Encode(buf, qoi, palette) || !WriteFile(file, buf))
     {
-        cout << "failed to save png: " << file << endl;
-        exit(EXIT_FAILURE);
+        cerr << "failed to save " << (qoi ? "qoi: " : "png: ") << file << endl;
+        return false;
     }
+    return true;
 }
 
 void Bitmap::CopyPixels(const Bitmap* src, int tx, int ty)
 {
+    //Each row is contiguous in both bitmaps, so it is copied in one go
     for (int y = 0; y < src->height; ++y)
-        for (int x = 0; x < src->width; ++x)
-            data[(ty + y) * width + (tx + x)] = src->data[y * src->width + x];
+        memcpy(data + size_t(ty + y) * width + tx, src->data + size_t(y) * src->width, sizeof(uint32_t) * src->width);
 }
 
 void Bitmap::CopyPixelsRot(const Bitmap* src, int tx, int ty)
@@ -178,7 +337,7 @@ void Bitmap::CopyPixelsRot(const Bitmap* src, int tx, int ty)
     int r = src->height - 1;
     for (int y = 0; y < src->width; ++y)
         for (int x = 0; x < src->height; ++x)
-            data[(ty + y) * width + (tx + x)] = src->data[(r - x) * src->width + y];
+            data[size_t(ty + y) * width + (tx + x)] = src->data[size_t(r - x) * src->width + y];
 }
 
 bool Bitmap::Equals(const Bitmap* other) const
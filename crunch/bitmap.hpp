@@ -30,6 +30,7 @@
 #include <string>
 #include <cstdint>
 #include <vector>
+#include <istream>
 
 using namespace std;
 
@@ -44,13 +45,36 @@ struct Bitmap
     int frameH;
     uint32_t* data;
     size_t hashValue;
+    
+    //If the file can't be loaded the error is printed and data is left null, so a batch can
+    //fail just the atlas that uses it
     Bitmap(const string& file, const string& name, bool premultiply, bool trim);
+    Bitmap(uint32_t* pixels, int width, int height, const string& name, bool premultiply, bool trim);
     Bitmap(int width, int height);
+    Bitmap(const Bitmap& bitmap, const string& name);
     ~Bitmap();
-    void SaveAs(const string& file);
+    bool Init(uint32_t* pixels, int w, int h, bool premultiply, bool trim);
+    void UpdateHash();
+    
+    //Grows the trimmed image with transparent pixels so its offset in the frame is a
+    //multiple, and its size too unless it reaches the edge of the frame
+    void AlignTrim(int multiple);
+    bool Encode(vector<unsigned char>& out, bool qoi, bool palette) const;
+    bool SaveAs(const string& file, bool palette);
     void CopyPixels(const Bitmap* src, int tx, int ty);
     void CopyPixelsRot(const Bitmap* src, int tx, int ty);
     bool Equals(const Bitmap* other) const;
 };
 
+//Decodes a png or qoi file into RGBA pixels allocated with malloc, which a Bitmap can take over
+bool LoadPixels(const string& file, uint32_t** pixels, int* w, int* h);
+
+//Reads one frame of a raw pixel stream, which is little-endian: [uint32] name length, the name,
+//[uint32] width, [uint32] height, then width * height RGBA pixels. Returns false if the frame
+//is cut off or invalid; the pixels are allocated with malloc, which a Bitmap can take over.
+bool ReadPixelFrame(istream& stream, string& name, uint32_t** pixels, int* w, int* h);
+
+//True for the file extensions (without the dot) that Bitmap can load
+bool IsBitmapExtension(const string& ext);
+
 #endif
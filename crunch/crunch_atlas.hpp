@@ -0,0 +1,392 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ crunch_atlas.hpp - header-only reader for crunch's binary atlases
+ =================================================================
+ 
+ Drop this file into a runtime to read the files written by
+ crunch --binary --bin-version 2 (AtlasView) and crunch --soa
+ (AtlasColumnsView). Both are views over the bytes of the file (usually
+ a memory mapping), so they never copy or allocate. Records are used in
+ place, so they require a little-endian host; on anything else Open()
+ fails.
+ 
+    crunch::AtlasView atlas;
+    if (atlas.Open(data, size))
+    {
+        const crunch::AtlasSprite* sprite = atlas.Find("player/idle0");
+        for (const crunch::AtlasSprite& s : atlas.Sprites())
+            printf("%s %u %u\n", atlas.GetName(s), s.x, s.y);
+    }
+ */
+
+#ifndef crunch_atlas_hpp
+#define crunch_atlas_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#define CRUNCH_ATLAS_VERSION 2
+#define CRUNCH_ATLAS_COLUMNS_VERSION 1
+
+namespace crunch
+{
+    enum AtlasFlags
+    {
+        ATLAS_TRIM = 1,
+        ATLAS_ROTATE = 2
+    };
+    
+    enum AtlasSpriteFlags
+    {
+        ATLAS_SPRITE_ROTATED = 1
+    };
+    
+    struct AtlasHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t headerSize;
+        uint32_t flags;
+        uint32_t fileSize;
+        uint32_t pageCount;
+        uint32_t spriteCount;
+        uint32_t pagesOffset;
+        uint32_t spritesOffset;
+        uint32_t spriteStride;
+        uint32_t stringsOffset;
+        uint32_t stringsSize;
+        uint32_t hashOffset;
+        uint32_t hashBuckets;
+        uint32_t hashSlots;
+        uint32_t reserved;
+    };
+    
+    struct AtlasPage
+    {
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t width;
+        uint32_t height;
+        uint32_t firstSprite;
+        uint32_t spriteCount;
+    };
+    
+    struct AtlasSprite
+    {
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t page;
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+        uint32_t height;
+        int32_t frameX;
+        int32_t frameY;
+        uint32_t frameWidth;
+        uint32_t frameHeight;
+        uint32_t flags;
+    };
+    
+    static_assert(sizeof(AtlasHeader) == 64, "atlas header must match the file layout");
+    static_assert(sizeof(AtlasPage) == 24, "atlas page must match the file layout");
+    static_assert(sizeof(AtlasSprite) == 48, "atlas sprite must match the file layout");
+    
+    //Header of a .soa file, where each sprite field is its own array in the
+    //same sprite order as the .bin. Offsets are from the start of the file.
+    struct AtlasColumnsHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t headerSize;
+        uint32_t fileSize;
+        uint32_t pageCount;
+        uint32_t spriteCount;
+        uint32_t pageSizesOffset;   //uint32 width, height per page
+        uint32_t pagesOffset;       //uint32 page per sprite
+        uint32_t xOffset;           //uint32 per sprite
+        uint32_t yOffset;           //uint32 per sprite
+        uint32_t widthOffset;       //uint32 per sprite
+        uint32_t heightOffset;      //uint32 per sprite
+        uint32_t frameXOffset;      //int32 per sprite
+        uint32_t frameYOffset;      //int32 per sprite
+        uint32_t frameWidthOffset;  //uint32 per sprite
+        uint32_t frameHeightOffset; //uint32 per sprite
+        uint32_t rotatedOffset;     //one bit per sprite, in uint32 words
+        uint32_t uvsOffset;         //float32 u, v of the top left, top right, bottom right and bottom left corners per sprite
+        uint32_t reserved[2];
+    };
+    
+    static_assert(sizeof(AtlasColumnsHeader) == 80, "atlas columns header must match the file layout");
+    
+    //64-bit FNV-1a of a sprite name, the key of the name index
+    inline uint64_t HashAtlasName(const char* name, size_t length)
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash ^= static_cast<unsigned char>(name[i]);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+    
+    inline uint32_t GetAtlasNameBucket(uint64_t hash, uint32_t bucketCount)
+    {
+        return static_cast<uint32_t>(hash % bucketCount);
+    }
+    
+    inline uint32_t GetAtlasNameSlot(uint64_t hash, uint32_t seed, uint32_t slotCount)
+    {
+        //MurmurHash3's 64-bit finalizer
+        uint64_t x = hash + seed;
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdull;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ull;
+        x ^= x >> 33;
+        return static_cast<uint32_t>(x % slotCount);
+    }
+    
+    //Steps through records that are spriteStride bytes apart
+    class AtlasSpriteIterator
+    {
+    public:
+        AtlasSpriteIterator(const unsigned char* ptr, size_t stride) : ptr(ptr), stride(stride) {}
+        const AtlasSprite& operator*() const { return *reinterpret_cast<const AtlasSprite*>(ptr); }
+        const AtlasSprite* operator->() const { return reinterpret_cast<const AtlasSprite*>(ptr); }
+        AtlasSpriteIterator& operator++() { ptr += stride; return *this; }
+        bool operator==(const AtlasSpriteIterator& other) const { return ptr == other.ptr; }
+        bool operator!=(const AtlasSpriteIterator& other) const { return ptr != other.ptr; }
+    private:
+        const unsigned char* ptr;
+        size_t stride;
+    };
+    
+    struct AtlasSpriteRange
+    {
+        AtlasSpriteIterator first;
+        AtlasSpriteIterator last;
+        AtlasSpriteIterator begin() const { return first; }
+        AtlasSpriteIterator end() const { return last; }
+    };
+    
+    //A read-only view of a version 2 atlas. The data must stay alive and
+    //4 byte aligned for as long as the view is used.
+    class AtlasView
+    {
+    public:
+        AtlasView() : data(nullptr), header(nullptr) {}
+        
+        //Checks the header and that every table lies inside the data. Names
+        //and indices inside the records are checked as they are used, so a
+        //damaged file can't cause reads outside of it.
+        bool Open(const void* bytes, size_t size)
+        {
+            data = nullptr;
+            header = nullptr;
+            const AtlasHeader* h = static_cast<const AtlasHeader*>(bytes);
+            if (bytes == nullptr || size < sizeof(AtlasHeader) || reinterpret_cast<uintptr_t>(bytes) % 4 != 0)
+                return false;
+            if (memcmp(h->magic, "CRAB", 4) != 0 || h->version != CRUNCH_ATLAS_VERSION || h->headerSize < sizeof(AtlasHeader) || h->fileSize > size)
+                return false;
+            if (h->spriteStride < sizeof(AtlasSprite) || h->spriteStride % 4 != 0 || h->pagesOffset % 4 != 0 || h->spritesOffset % 4 != 0 || h->hashOffset % 4 != 0)
+                return false;
+            uint64_t end = h->fileSize;
+            if (uint64_t(h->pagesOffset) + uint64_t(h->pageCount) * sizeof(AtlasPage) > end)
+                return false;
+            if (uint64_t(h->spritesOffset) + uint64_t(h->spriteCount) * h->spriteStride > end)
+                return false;
+            if (uint64_t(h->stringsOffset) + h->stringsSize > end)
+                return false;
+            if (h->hashSlots != 0 && (h->hashBuckets == 0 || uint64_t(h->hashOffset) + (uint64_t(h->hashBuckets) + h->hashSlots) * 4 > end))
+                return false;
+            data = static_cast<const unsigned char*>(bytes);
+            header = h;
+            return true;
+        }
+        
+        bool IsOpen() const { return header != nullptr; }
+        uint32_t GetFlags() const { return header->flags; }
+        size_t GetPageCount() const { return header->pageCount; }
+        size_t GetSpriteCount() const { return header->spriteCount; }
+        
+        const AtlasPage& GetPage(size_t index) const
+        {
+            return reinterpret_cast<const AtlasPage*>(data + header->pagesOffset)[index];
+        }
+        
+        const AtlasSprite& GetSprite(size_t index) const
+        {
+            return *reinterpret_cast<const AtlasSprite*>(data + header->spritesOffset + index * header->spriteStride);
+        }
+        
+        //Null terminated names, or "" if the record points outside the string table
+        const char* GetName(const AtlasPage& page) const
+        {
+            const char* str = GetString(page.nameOffset, page.nameLength);
+            return str != nullptr ? str : "";
+        }
+        
+        const char* GetName(const AtlasSprite& sprite) const
+        {
+            const char* str = GetString(sprite.nameOffset, sprite.nameLength);
+            return str != nullptr ? str : "";
+        }
+        
+        AtlasSpriteRange Sprites() const
+        {
+            return GetRange(0, header->spriteCount);
+        }
+        
+        AtlasSpriteRange Sprites(const AtlasPage& page) const
+        {
+            uint32_t first = page.firstSprite < header->spriteCount ? page.firstSprite : header->spriteCount;
+            uint32_t count = page.spriteCount < header->spriteCount - first ? page.spriteCount : header->spriteCount - first;
+            return GetRange(first, count);
+        }
+        
+        //Finds a sprite by name with the file's name index, or by searching
+        //every record if the file has none. Returns null if there is no match.
+        const AtlasSprite* Find(const char* name, size_t length) const
+        {
+            if (header->hashSlots == 0)
+            {
+                for (const AtlasSprite& sprite : Sprites())
+                    if (NameEquals(sprite, name, length))
+                        return &sprite;
+                return nullptr;
+            }
+            
+            const uint32_t* buckets = reinterpret_cast<const uint32_t*>(data + header->hashOffset);
+            const uint32_t* slots = buckets + header->hashBuckets;
+            uint64_t hash = HashAtlasName(name, length);
+            int32_t displacement = static_cast<int32_t>(buckets[GetAtlasNameBucket(hash, header->hashBuckets)]);
+            uint32_t slot = displacement < 0 ? static_cast<uint32_t>(-(displacement + 1)) : GetAtlasNameSlot(hash, static_cast<uint32_t>(displacement), header->hashSlots);
+            if (slot >= header->hashSlots || slots[slot] >= header->spriteCount)
+                return nullptr;
+            const AtlasSprite& sprite = GetSprite(slots[slot]);
+            return NameEquals(sprite, name, length) ? &sprite : nullptr;
+        }
+        
+        const AtlasSprite* Find(const char* name) const
+        {
+            return Find(name, strlen(name));
+        }
+        
+    private:
+        const unsigned char* data;
+        const AtlasHeader* header;
+        
+        const char* GetString(uint32_t offset, uint32_t length) const
+        {
+            if (uint64_t(offset) + length >= header->stringsSize)
+                return nullptr;
+            const char* str = reinterpret_cast<const char*>(data + header->stringsOffset + offset);
+            return str[length] == '\0' ? str : nullptr;
+        }
+        
+        bool NameEquals(const AtlasSprite& sprite, const char* name, size_t length) const
+        {
+            const char* str = GetString(sprite.nameOffset, sprite.nameLength);
+            return str != nullptr && sprite.nameLength == length && memcmp(str, name, length) == 0;
+        }
+        
+        AtlasSpriteRange GetRange(uint32_t first, uint32_t count) const
+        {
+            const unsigned char* ptr = data + header->spritesOffset + size_t(first) * header->spriteStride;
+            AtlasSpriteRange range = {
+                AtlasSpriteIterator(ptr, header->spriteStride),
+                AtlasSpriteIterator(ptr + size_t(count) * header->spriteStride, header->spriteStride)
+            };
+            return range;
+        }
+    };
+    
+    //A read-only view of a .soa file, giving each column as a plain array
+    class AtlasColumnsView
+    {
+    public:
+        AtlasColumnsView() : data(nullptr), header(nullptr) {}
+        
+        //Checks the header and that every array lies inside the data
+        bool Open(const void* bytes, size_t size)
+        {
+            data = nullptr;
+            header = nullptr;
+            const AtlasColumnsHeader* h = static_cast<const AtlasColumnsHeader*>(bytes);
+            if (bytes == nullptr || size < sizeof(AtlasColumnsHeader) || reinterpret_cast<uintptr_t>(bytes) % 4 != 0)
+                return false;
+            if (memcmp(h->magic, "CRSA", 4) != 0 || h->version != CRUNCH_ATLAS_COLUMNS_VERSION || h->headerSize < sizeof(AtlasColumnsHeader) || h->fileSize > size)
+                return false;
+            uint64_t n = h->spriteCount;
+            if (!Fits(h, h->pageSizesOffset, uint64_t(h->pageCount) * 8) || !Fits(h, h->pagesOffset, n * 4) ||
+                !Fits(h, h->xOffset, n * 4) || !Fits(h, h->yOffset, n * 4) || !Fits(h, h->widthOffset, n * 4) || !Fits(h, h->heightOffset, n * 4) ||
+                !Fits(h, h->frameXOffset, n * 4) || !Fits(h, h->frameYOffset, n * 4) || !Fits(h, h->frameWidthOffset, n * 4) || !Fits(h, h->frameHeightOffset, n * 4) ||
+                !Fits(h, h->rotatedOffset, (n + 31) / 32 * 4) || !Fits(h, h->uvsOffset, n * 32))
+                return false;
+            data = static_cast<const unsigned char*>(bytes);
+            header = h;
+            return true;
+        }
+        
+        bool IsOpen() const { return header != nullptr; }
+        size_t GetPageCount() const { return header->pageCount; }
+        size_t GetSpriteCount() const { return header->spriteCount; }
+        const uint32_t* GetPageSizes() const { return Get<uint32_t>(header->pageSizesOffset); }
+        const uint32_t* GetPages() const { return Get<uint32_t>(header->pagesOffset); }
+        const uint32_t* GetX() const { return Get<uint32_t>(header->xOffset); }
+        const uint32_t* GetY() const { return Get<uint32_t>(header->yOffset); }
+        const uint32_t* GetWidths() const { return Get<uint32_t>(header->widthOffset); }
+        const uint32_t* GetHeights() const { return Get<uint32_t>(header->heightOffset); }
+        const int32_t* GetFrameX() const { return Get<int32_t>(header->frameXOffset); }
+        const int32_t* GetFrameY() const { return Get<int32_t>(header->frameYOffset); }
+        const uint32_t* GetFrameWidths() const { return Get<uint32_t>(header->frameWidthOffset); }
+        const uint32_t* GetFrameHeights() const { return Get<uint32_t>(header->frameHeightOffset); }
+        const float* GetUVs() const { return Get<float>(header->uvsOffset); }
+        
+        bool IsRotated(size_t index) const
+        {
+            return (Get<uint32_t>(header->rotatedOffset)[index / 32] >> (index % 32)) & 1;
+        }
+        
+    private:
+        const unsigned char* data;
+        const AtlasColumnsHeader* header;
+        
+        static bool Fits(const AtlasColumnsHeader* h, uint32_t offset, uint64_t size)
+        {
+            return offset % 4 == 0 && offset + size <= h->fileSize;
+        }
+        
+        template <typename T>
+        const T* Get(uint32_t offset) const
+        {
+            return reinterpret_cast<const T*>(data + offset);
+        }
+    };
+}
+
+#endif
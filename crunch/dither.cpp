@@ -0,0 +1,137 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+#include "dither.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+
+const PackedLayout layoutRgba4444 = { { 4, 4, 4, 4 }, { 12, 8, 4, 0 } };
+const PackedLayout layoutRgb565 = { { 5, 6, 5, 0 }, { 11, 5, 0, 0 } };
+const PackedLayout layoutRgba5551 = { { 5, 5, 5, 1 }, { 11, 6, 1, 0 } };
+
+//4x4 Bayer matrix, scaled to thresholds in [-0.5, 0.5) of a quantization step
+static const int bayer[4][4] = {
+    { 0, 8, 2, 10 },
+    { 12, 4, 14, 6 },
+    { 3, 11, 1, 9 },
+    { 15, 7, 13, 5 }
+};
+
+static inline void Store16(unsigned char* out, uint32_t v)
+{
+    out[0] = static_cast<unsigned char>(v & 0xff);
+    out[1] = static_cast<unsigned char>(v >> 8);
+}
+
+static inline int Quantize(int value, int maxValue)
+{
+    return (value * maxValue + 127) / 255;
+}
+
+static void PackRowOrdered(const unsigned char* src, int width, int y, const PackedLayout& layout, bool dither, unsigned char* out)
+{
+    //Per-channel offsets for this row: a Bayer threshold scaled to one step
+    //of each channel, in 1/16ths of a 255 range step
+    const int* row = bayer[y & 3];
+    for (int x = 0; x < width; ++x)
+    {
+        const unsigned char* p = src + size_t(x) * 4;
+        int offset = dither && p[3] != 0 ? row[x & 3] * 2 - 15 : 0;
+        uint32_t v = 0;
+        for (int c = 0; c < 4; ++c)
+        {
+            int bits = layout.bits[c];
+            if (bits == 0)
+                continue;
+            int maxValue = (1 << bits) - 1;
+            int value = p[c];
+            
+            //1-bit alpha is a plain threshold, dithering it would speckle edges
+            if (bits > 1)
+                value += offset * 255 / (maxValue * 32);
+            value = min(255, max(0, value));
+            v |= static_cast<uint32_t>(Quantize(value, maxValue)) << layout.shift[c];
+        }
+        Store16(out + size_t(x) * 2, v);
+    }
+}
+
+static void PackFloydSteinberg(const unsigned char* src, int width, int height, const PackedLayout& layout, unsigned char* out)
+{
+    //Error for the current and next row, per channel, in 1/16ths
+    vector<int> errors(size_t(width + 2) * 4 * 2, 0);
+    int* cur = errors.data();
+    int* next = cur + (width + 2) * 4;
+    
+    for (int y = 0; y < height; ++y)
+    {
+        fill(next, next + (width + 2) * 4, 0);
+        for (int x = 0; x < width; ++x)
+        {
+            const unsigned char* p = src + (size_t(y) * width + x) * 4;
+            bool transparent = p[3] == 0;
+            uint32_t v = 0;
+            for (int c = 0; c < 4; ++c)
+            {
+                int bits = layout.bits[c];
+                if (bits == 0)
+                    continue;
+                int maxValue = (1 << bits) - 1;
+                int i = (x + 1) * 4 + c;
+                int value = p[c];
+                if (!transparent && bits > 1)
+                    value += cur[i] / 16;
+                value = min(255, max(0, value));
+                int q = Quantize(value, maxValue);
+                v |= static_cast<uint32_t>(q) << layout.shift[c];
+                
+                if (transparent || bits == 1)
+                    continue;
+                int err = value - (q * 255 + maxValue / 2) / maxValue;
+                cur[i + 4] += err * 7;
+                next[i - 4] += err * 3;
+                next[i] += err * 5;
+                next[i + 4] += err;
+            }
+            Store16(out + (size_t(y) * width + x) * 2, v);
+        }
+        swap(cur, next);
+    }
+}
+
+void PackPixels(const unsigned char* src, int width, int height, const PackedLayout& layout, DitherMode dither, vector<unsigned char>& out)
+{
+    out.resize(size_t(width) * height * 2);
+    if (dither == DITHER_FLOYD_STEINBERG)
+    {
+        PackFloydSteinberg(src, width, height, layout, out.data());
+        return;
+    }
+    
+    ParallelFor(height, [&](int y) {
+        PackRowOrdered(src + size_t(y) * width * 4, width, y, layout, dither == DITHER_ORDERED, out.data() + size_t(y) * width * 2);
+    });
+}
@@ -0,0 +1,57 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+#ifndef dither_hpp
+#define dither_hpp
+
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+enum DitherMode
+{
+    DITHER_NONE,
+    DITHER_ORDERED,
+    DITHER_FLOYD_STEINBERG
+};
+
+//Bits per channel and bit position of each channel in a 16-bit pixel
+struct PackedLayout
+{
+    int bits[4];
+    int shift[4];
+};
+
+extern const PackedLayout layoutRgba4444;
+extern const PackedLayout layoutRgb565;
+extern const PackedLayout layoutRgba5551;
+
+//Converts RGBA8 pixels to little-endian 16-bit pixels. Fully transparent
+//pixels are never dithered, so premultiplied edges stay clean.
+void PackPixels(const unsigned char* src, int width, int height, const PackedLayout& layout, DitherMode dither, vector<unsigned char>& out);
+
+#endif
@@ -0,0 +1,449 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+#include "etc.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace std;
+
+static const int etcModifiers[8][2] = {
+    { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+static const int eacModifiers[16][8] = {
+    { -3, -6, -9, -15, 2, 5, 8, 14 },
+    { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5, -8, -13, 1, 4, 7, 12 },
+    { -2, -4, -6, -13, 1, 3, 5, 12 },
+    { -3, -6, -8, -12, 2, 5, 7, 11 },
+    { -3, -7, -9, -11, 2, 6, 8, 10 },
+    { -4, -7, -8, -11, 3, 6, 7, 10 },
+    { -3, -5, -8, -11, 2, 4, 7, 10 },
+    { -2, -6, -8, -10, 1, 5, 7, 9 },
+    { -2, -5, -8, -10, 1, 4, 7, 9 },
+    { -2, -4, -8, -10, 1, 3, 7, 9 },
+    { -2, -5, -7, -10, 1, 4, 6, 9 },
+    { -3, -4, -7, -10, 2, 3, 6, 9 },
+    { -1, -2, -3, -10, 0, 1, 2, 9 },
+    { -4, -6, -8, -9, 3, 5, 7, 8 },
+    { -3, -5, -7, -9, 2, 4, 6, 8 }
+};
+
+static inline int Clamp255(int v)
+{
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+static void StoreBigEndian(uint64_t bits, unsigned char* out)
+{
+    for (int i = 0; i < 8; ++i)
+        out[i] = static_cast<unsigned char>(bits >> (56 - i * 8));
+}
+
+//ETC blocks number their pixels down each column
+static inline int PixelIndex(int x, int y)
+{
+    return x * 4 + y;
+}
+
+//EAC alpha ------------------------------------------------------------------
+
+static int EncodeAlphaWith(const int* alpha, int base, int mult, int table, uint64_t* indices)
+{
+    int error = 0;
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        int best = 0, bestDist = 1 << 30;
+        for (int j = 0; j < 8; ++j)
+        {
+            int d = abs(alpha[i] - Clamp255(base + eacModifiers[table][j] * mult));
+            if (d < bestDist)
+            {
+                bestDist = d;
+                best = j;
+            }
+        }
+        error += bestDist * bestDist;
+        bits |= static_cast<uint64_t>(best) << (45 - 3 * i);
+    }
+    *indices = bits;
+    return error;
+}
+
+static void EncodeAlpha(const unsigned char* block, unsigned char* out, bool best)
+{
+    //Gather alpha in ETC pixel order
+    int alpha[16];
+    int lo = 255, hi = 0;
+    for (int y = 0; y < 4; ++y)
+    {
+        for (int x = 0; x < 4; ++x)
+        {
+            int a = block[(y * 4 + x) * 4 + 3];
+            alpha[PixelIndex(x, y)] = a;
+            lo = min(lo, a);
+            hi = max(hi, a);
+        }
+    }
+    
+    uint64_t bestBits = 0;
+    int bestError = 1 << 30;
+    int bestBase = 0, bestMult = 1, bestTable = 13;
+    int center = (lo + hi + 1) / 2;
+    for (int table = 0; table < 16 && bestError > 0; ++table)
+    {
+        int range = eacModifiers[table][7] - eacModifiers[table][3];
+        int mult = max(1, min(15, (hi - lo + range / 2) / range));
+        int spread = best ? 2 : 0;
+        for (int m = max(1, mult - spread / 2); m <= min(15, mult + spread / 2); ++m)
+        {
+            for (int b = center - spread; b <= center + spread; ++b)
+            {
+                int base = Clamp255(b);
+                uint64_t bits;
+                int error = EncodeAlphaWith(alpha, base, m, table, &bits);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    bestBits = bits;
+                    bestBase = base;
+                    bestMult = m;
+                    bestTable = table;
+                }
+            }
+        }
+    }
+    
+    uint64_t bits = (static_cast<uint64_t>(bestBase) << 56) | (static_cast<uint64_t>(bestMult) << 52) | (static_cast<uint64_t>(bestTable) << 48) | bestBits;
+    StoreBigEndian(bits, out);
+}
+
+//ETC1 color -----------------------------------------------------------------
+
+struct SubBlock
+{
+    int pixels[8][3];
+    int index[8]; //ETC pixel number of each pixel
+    int count;
+};
+
+struct SubBlockFit
+{
+    int color[3]; //quantized base color
+    int table;
+    uint32_t msb;
+    uint32_t lsb;
+    int error;
+};
+
+static void FitTable(const SubBlock& sub, const int* base, SubBlockFit& fit)
+{
+    fit.error = 1 << 30;
+    for (int table = 0; table < 8; ++table)
+    {
+        int mods[4] = { etcModifiers[table][0], etcModifiers[table][1], -etcModifiers[table][0], -etcModifiers[table][1] };
+        int error = 0;
+        uint32_t msb = 0, lsb = 0;
+        for (int i = 0; i < sub.count && error < fit.error; ++i)
+        {
+            int best = 0, bestDist = 1 << 30;
+            for (int j = 0; j < 4; ++j)
+            {
+                int dr = sub.pixels[i][0] - Clamp255(base[0] + mods[j]);
+                int dg = sub.pixels[i][1] - Clamp255(base[1] + mods[j]);
+                int db = sub.pixels[i][2] - Clamp255(base[2] + mods[j]);
+                int d = dr * dr + dg * dg + db * db;
+                if (d < bestDist)
+                {
+                    bestDist = d;
+                    best = j;
+                }
+            }
+            error += bestDist;
+            msb |= static_cast<uint32_t>(best >> 1) << sub.index[i];
+            lsb |= static_cast<uint32_t>(best & 1) << sub.index[i];
+        }
+        if (error < fit.error)
+        {
+            fit.error = error;
+            fit.table = table;
+            fit.msb = msb;
+            fit.lsb = lsb;
+        }
+    }
+}
+
+static inline int Expand4(int v)
+{
+    return (v << 4) | v;
+}
+
+static inline int Expand5(int v)
+{
+    return (v << 3) | (v >> 2);
+}
+
+//Tries base colors around the subblock average, quantized to the given bit depth
+static void FitSubBlock(const SubBlock& sub, int bits, int spread, SubBlockFit* fits, int& numFits)
+{
+    int sum[3] = { 0, 0, 0 };
+    for (int i = 0; i < sub.count; ++i)
+        for (int c = 0; c < 3; ++c)
+            sum[c] += sub.pixels[i][c];
+    int maxValue = (1 << bits) - 1;
+    int q[3];
+    for (int c = 0; c < 3; ++c)
+        q[c] = (sum[c] * maxValue + sub.count * 255 / 2) / (sub.count * 255);
+    
+    numFits = 0;
+    for (int k = -spread; k <= spread; ++k)
+    {
+        SubBlockFit& fit = fits[numFits++];
+        int base[3];
+        for (int c = 0; c < 3; ++c)
+        {
+            fit.color[c] = min(maxValue, max(0, q[c] + k));
+            base[c] = bits == 4 ? Expand4(fit.color[c]) : Expand5(fit.color[c]);
+        }
+        FitTable(sub, base, fit);
+    }
+}
+
+static void SplitBlock(const unsigned char* block, bool flip, SubBlock* subs)
+{
+    subs[0].count = subs[1].count = 0;
+    for (int y = 0; y < 4; ++y)
+    {
+        for (int x = 0; x < 4; ++x)
+        {
+            SubBlock& sub = subs[flip ? (y >= 2) : (x >= 2)];
+            const unsigned char* p = block + (y * 4 + x) * 4;
+            sub.pixels[sub.count][0] = p[0];
+            sub.pixels[sub.count][1] = p[1];
+            sub.pixels[sub.count][2] = p[2];
+            sub.index[sub.count] = PixelIndex(x, y);
+            ++sub.count;
+        }
+    }
+}
+
+static uint64_t PackColorBlock(const SubBlockFit& a, const SubBlockFit& b, bool diff, bool flip)
+{
+    uint64_t bits = 0;
+    for (int c = 0; c < 3; ++c)
+    {
+        int shift = 59 - c * 8;
+        if (diff)
+        {
+            int delta = (b.color[c] - a.color[c]) & 7;
+            bits |= static_cast<uint64_t>(a.color[c]) << shift;
+            bits |= static_cast<uint64_t>(delta) << (shift - 3);
+        }
+        else
+        {
+            bits |= static_cast<uint64_t>(a.color[c]) << (shift + 1);
+            bits |= static_cast<uint64_t>(b.color[c]) << (shift - 3);
+        }
+    }
+    bits |= static_cast<uint64_t>(a.table) << 37;
+    bits |= static_cast<uint64_t>(b.table) << 34;
+    bits |= static_cast<uint64_t>(diff ? 1 : 0) << 33;
+    bits |= static_cast<uint64_t>(flip ? 1 : 0) << 32;
+    bits |= static_cast<uint64_t>(a.msb | b.msb) << 16;
+    bits |= static_cast<uint64_t>(a.lsb | b.lsb);
+    return bits;
+}
+
+//ETC2 planar mode ------------------------------------------------------------
+
+static inline int Expand6(int v)
+{
+    return (v << 2) | (v >> 4);
+}
+
+static inline int Expand7(int v)
+{
+    return (v << 1) | (v >> 6);
+}
+
+//Fits a plane through the block (origin, horizontal and vertical corner
+//colors in 6.7.6 bits), which suits smooth gradients far better than ETC1
+static int EncodePlanar(const unsigned char* block, uint64_t* out)
+{
+    static const int bits[3] = { 6, 7, 6 };
+    int o[3], h[3], v[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        //Least squares fit of value = a + b * x + d * y
+        float sum = 0.0f, sx = 0.0f, sy = 0.0f;
+        for (int y = 0; y < 4; ++y)
+        {
+            for (int x = 0; x < 4; ++x)
+            {
+                float value = block[(y * 4 + x) * 4 + c];
+                sum += value;
+                sx += (x - 1.5f) * value;
+                sy += (y - 1.5f) * value;
+            }
+        }
+        float b = sx / 20.0f;
+        float d = sy / 20.0f;
+        float a = sum / 16.0f - 1.5f * (b + d);
+        
+        int maxValue = (1 << bits[c]) - 1;
+        float scale = maxValue / 255.0f;
+        o[c] = min(maxValue, max(0, static_cast<int>(a * scale + 0.5f)));
+        h[c] = min(maxValue, max(0, static_cast<int>((a + 4.0f * b) * scale + 0.5f)));
+        v[c] = min(maxValue, max(0, static_cast<int>((a + 4.0f * d) * scale + 0.5f)));
+    }
+    
+    int eo[3] = { Expand6(o[0]), Expand7(o[1]), Expand6(o[2]) };
+    int eh[3] = { Expand6(h[0]), Expand7(h[1]), Expand6(h[2]) };
+    int ev[3] = { Expand6(v[0]), Expand7(v[1]), Expand6(v[2]) };
+    int error = 0;
+    for (int y = 0; y < 4; ++y)
+    {
+        for (int x = 0; x < 4; ++x)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                int value = Clamp255((x * (eh[c] - eo[c]) + y * (ev[c] - eo[c]) + 4 * eo[c] + 2) >> 2);
+                int d = value - block[(y * 4 + x) * 4 + c];
+                error += d * d;
+            }
+        }
+    }
+    
+    uint64_t result = 0;
+    result |= static_cast<uint64_t>(o[0]) << 57;
+    result |= static_cast<uint64_t>(o[1] >> 6) << 56;
+    result |= static_cast<uint64_t>(o[1] & 63) << 49;
+    result |= static_cast<uint64_t>(o[2] >> 5) << 48;
+    result |= static_cast<uint64_t>((o[2] >> 3) & 3) << 43;
+    result |= static_cast<uint64_t>(o[2] & 7) << 39;
+    result |= static_cast<uint64_t>(h[0] >> 1) << 34;
+    result |= static_cast<uint64_t>(1) << 33;
+    result |= static_cast<uint64_t>(h[0] & 1) << 32;
+    result |= static_cast<uint64_t>(h[1]) << 25;
+    result |= static_cast<uint64_t>(h[2]) << 19;
+    result |= static_cast<uint64_t>(v[0]) << 13;
+    result |= static_cast<uint64_t>(v[1]) << 6;
+    result |= static_cast<uint64_t>(v[2]);
+    
+    //Planar blocks are flagged by the differential red and green staying in
+    //range while blue overflows, so set the unused bits to make that happen
+    int r = static_cast<int>((result >> 59) & 15);
+    int dr = static_cast<int>((result >> 56) & 7);
+    if (r + (dr >= 4 ? dr - 8 : dr) < 0)
+        result |= static_cast<uint64_t>(1) << 63;
+    int g = static_cast<int>((result >> 51) & 15);
+    int dg = static_cast<int>((result >> 48) & 7);
+    if (g + (dg >= 4 ? dg - 8 : dg) < 0)
+        result |= static_cast<uint64_t>(1) << 55;
+    int b = static_cast<int>((result >> 43) & 3);
+    int db = static_cast<int>((result >> 40) & 3);
+    if (b + db > 3)
+        result |= static_cast<uint64_t>(7) << 45;
+    else
+        result |= static_cast<uint64_t>(1) << 42;
+    
+    *out = result;
+    return error;
+}
+
+static void EncodeColor(const unsigned char* block, unsigned char* out, bool best)
+{
+    int spread = best ? 2 : 0;
+    uint64_t bestBits = 0;
+    int bestError = EncodePlanar(block, &bestBits);
+    
+    for (int flip = 0; flip < 2; ++flip)
+    {
+        SubBlock subs[2];
+        SplitBlock(block, flip != 0, subs);
+        
+        SubBlockFit fits[2][5];
+        int numFits[2];
+        
+        //Individual mode: two independent 4-bit colors
+        for (int s = 0; s < 2; ++s)
+            FitSubBlock(subs[s], 4, spread, fits[s], numFits[s]);
+        const SubBlockFit* pick[2];
+        for (int s = 0; s < 2; ++s)
+        {
+            pick[s] = &fits[s][0];
+            for (int i = 1; i < numFits[s]; ++i)
+                if (fits[s][i].error < pick[s]->error)
+                    pick[s] = &fits[s][i];
+        }
+        if (pick[0]->error + pick[1]->error < bestError)
+        {
+            bestError = pick[0]->error + pick[1]->error;
+            bestBits = PackColorBlock(*pick[0], *pick[1], false, flip != 0);
+        }
+        
+        //Differential mode: 5-bit colors whose difference must fit in 3 bits,
+        //otherwise an ETC2 decoder would read the block as T, H or planar
+        for (int s = 0; s < 2; ++s)
+            FitSubBlock(subs[s], 5, spread, fits[s], numFits[s]);
+        for (int i = 0; i < numFits[0]; ++i)
+        {
+            for (int j = 0; j < numFits[1]; ++j)
+            {
+                const SubBlockFit& a = fits[0][i];
+                const SubBlockFit& b = fits[1][j];
+                bool valid = true;
+                for (int c = 0; c < 3; ++c)
+                {
+                    int d = b.color[c] - a.color[c];
+                    valid = valid && d >= -4 && d <= 3;
+                }
+                if (valid && a.error + b.error < bestError)
+                {
+                    bestError = a.error + b.error;
+                    bestBits = PackColorBlock(a, b, true, flip != 0);
+                }
+            }
+        }
+    }
+    
+    StoreBigEndian(bestBits, out);
+}
+
+void EncodeEtc2Fast(const unsigned char* block, unsigned char* out)
+{
+    EncodeAlpha(block, out, false);
+    EncodeColor(block, out + 8, false);
+}
+
+void EncodeEtc2Best(const unsigned char* block, unsigned char* out)
+{
+    EncodeAlpha(block, out, true);
+    EncodeColor(block, out + 8, true);
+}
@@ -31,6 +31,8 @@
 #include <sstream>
 #include "tinydir.h"
 #include "str.hpp"
+#include "bitmap.hpp"
+#include "slice.hpp"
 
 template <class T>
 void HashCombine(std::size_t& hash, const T& v)
@@ -48,23 +50,40 @@ void HashString(size_t& hash, const string& str)
     HashCombine(hash, str);
 }
 
-void HashFile(size_t& hash, const string& file)
+//Files in known are hashed by the value stored for them instead of being read again, and
+//files that have to be read are added to it
+bool HashFile(size_t& hash, const string& file, FileHashes* known)
 {
+    if (known != nullptr)
+    {
+        auto it = known->find(file);
+        if (it != known->end())
+        {
+            HashCombine(hash, it->second);
+            return true;
+        }
+    }
+    
     ifstream stream(file, ios::binary | ios::ate);
     streamsize size = stream.tellg();
     stream.seekg(0, ios::beg);
-    vector<char> buffer(size + 1);
-    if (!stream.read(buffer.data(), size))
+    vector<char> buffer(size > 0 ? size + 1 : 1);
+    if (!stream || size < 0 || !stream.read(buffer.data(), size))
     {
         cerr << "failed to read file: " << file << endl;
-        exit(EXIT_FAILURE);
+        return false;
     }
     buffer[size] = '\0';
     string text(buffer.begin(), buffer.end());
-    HashCombine(hash, text);
+    size_t value = std::hash<string>()(text);
+    if (known != nullptr)
+        (*known)[file] = value;
+    HashCombine(hash, value);
+    return true;
 }
 
-void HashFiles(size_t& hash, const string& root)
+//Returns false if one of the files can't be read
+bool HashFiles(size_t& hash, const string& root, FileHashes* known)
 {
     static string dot1 = ".";
     static string dot2 = "..";
@@ -74,10 +93,11 @@ void HashFiles(size_t& hash, const string& root)
     // tinydir_open on Windows (with UNICODE) expects const wchar_t*.
     if (tinydir_open(&dir, StrToPath(root).c_str()) == -1) {
         cerr << "Error opening directory for hashing: " << root << endl;
-        return;
+        return true;
     }
     
-    while (dir.has_next)
+    bool read = true;
+    while (dir.has_next && read)
     {
         tinydir_file file;
         tinydir_readfile(&dir, &file);
@@ -92,15 +112,18 @@ void HashFiles(size_t& hash, const string& root)
         if (file.is_dir)
         {
             if (dot1 != current_file_name && dot2 != current_file_name)
-                HashFiles(hash, current_file_path); // current_file_path is now std::string
+                read = HashFiles(hash, current_file_path, known); // current_file_path is now std::string
         }
-        else if (current_file_ext == "png") // PathToStr(file.extension) gives "png" not ".png"
-            HashFile(hash, current_file_path);
+        else if (IsBitmapExtension(current_file_ext)) // PathToStr(file.extension) gives "png" not ".png"
+            read = HashFile(hash, current_file_path, known);
+        else if (IsSliceFile(current_file_name))
+            read = HashFile(hash, current_file_path, known);
         
         tinydir_next(&dir);
     }
     
     tinydir_close(&dir);
+    return read;
 }
 
 void HashData(size_t& hash, const char* data, size_t size)
@@ -28,14 +28,18 @@
 #define hash_hpp
 
 #include <string>
+#include <unordered_map>
 using namespace std;
 
+//Content hashes of files by path, for callers that know which files haven't changed since
+typedef unordered_map<string, size_t> FileHashes;
+
 template <class T>
 void HashCombine(std::size_t& hash, const T& v);
 void HashCombine(std::size_t& hash, size_t v);
 void HashString(size_t& hash, const string& str);
-void HashFile(size_t& hash, const string& file);
-void HashFiles(size_t& hash, const string& root);
+bool HashFile(size_t& hash, const string& file, FileHashes* known = nullptr);
+bool HashFiles(size_t& hash, const string& root, FileHashes* known = nullptr);
 void HashData(size_t& hash, const char* data, size_t size);
 bool LoadHash(size_t& hash, const string& file);
 void SaveHash(size_t hash, const string& file);
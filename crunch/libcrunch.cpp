@@ -0,0 +1,360 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+
+#include "libcrunch.hpp"
+#include "bitmap.hpp"
+#include "packer.hpp"
+#include "texture.hpp"
+#include "atlas.hpp"
+#include "binary.hpp"
+#include "textwriter.hpp"
+#include <algorithm>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+namespace crunch
+{
+    Options::Options()
+    : width(4096), height(4096), padding(1), premultiply(false), trim(false), unique(false), rotate(false),
+      imageFormat(IMAGE_PNG), pixelFormat(PIXELS_RGBA8), dithering(DITHERING_NONE), mips(0),
+      bestQuality(false), lz4(false), palette(false), jsonCompact(false), jsonColumns(false)
+    {
+        
+    }
+    
+    static bool IsCompressed(PixelFormat format)
+    {
+        return format == PIXELS_BC1 || format == PIXELS_BC3 || format == PIXELS_BC7 || format == PIXELS_ETC2;
+    }
+    
+    //Same placement alignment as the command line, compressed blocks and mip levels
+    //never hold texels of two sprites
+    static int GetAlign(const Options& options)
+    {
+        return (IsCompressed(options.pixelFormat) ? 4 : 1) << options.mips;
+    }
+    
+    //The same combinations the command line rejects
+    static bool IsValid(const Options& options)
+    {
+        if (options.width < PACKER_MIN_SIZE || options.width > PACKER_MAX_SIZE || options.height < PACKER_MIN_SIZE || options.height > PACKER_MAX_SIZE)
+            return false;
+        if (options.padding < 0 || options.padding > 16)
+            return false;
+        
+        bool image = options.imageFormat == IMAGE_PNG || options.imageFormat == IMAGE_QOI;
+        if (image && options.pixelFormat != PIXELS_RGBA8)
+            return false;
+        if (IsCompressed(options.pixelFormat) && (options.width % 4 != 0 || options.height % 4 != 0))
+            return false;
+        if (options.pixelFormat == PIXELS_ETC2 && options.imageFormat == IMAGE_DDS)
+            return false;
+        if (options.mips < 0 || options.mips > PACKER_MAX_MIPS || (image && options.mips > 0))
+            return false;
+        if (options.width % GetAlign(options) != 0 || options.height % GetAlign(options) != 0)
+            return false;
+        if (options.palette && options.imageFormat != IMAGE_PNG)
+            return false;
+        if (options.lz4 && options.imageFormat != IMAGE_RAW)
+            return false;
+        return true;
+    }
+    
+    Atlas::Atlas(const Options& options)
+    : options(options), packed(false)
+    {
+        
+    }
+    
+    Atlas::~Atlas()
+    {
+        for (Packer* packer : packers)
+        {
+            for (Bitmap* bitmap : packer->bitmaps)
+                delete bitmap;
+            delete packer;
+        }
+        for (Bitmap* bitmap : bitmaps)
+            delete bitmap;
+    }
+    
+    Result Atlas::AddSprite(const string& name, const unsigned char* rgba, int width, int height)
+    {
+        if (packed)
+            return RESULT_INVALID_SPRITE;
+        if (rgba == nullptr || width <= 0 || height <= 0)
+            return RESULT_INVALID_SPRITE;
+        
+        //The bitmap premultiplies and trims in place, so it gets its own copy
+        size_t bytes = sizeof(uint32_t) * static_cast<size_t>(width) * height;
+        uint32_t* pixels = static_cast<uint32_t*>(malloc(bytes));
+        if (pixels == nullptr)
+            return RESULT_INVALID_SPRITE;
+        memcpy(pixels, rgba, bytes);
+        bitmaps.push_back(new Bitmap(pixels, width, height, name, options.premultiply, options.trim));
+        return RESULT_OK;
+    }
+    
+    Result Atlas::AddSprite(const string& name, const string& file)
+    {
+        if (packed)
+            return RESULT_INVALID_SPRITE;
+        uint32_t* pixels;
+        int width, height;
+        if (!LoadPixels(file, &pixels, &width, &height))
+            return RESULT_LOAD_FAILED;
+        bitmaps.push_back(new Bitmap(pixels, width, height, name, options.premultiply, options.trim));
+        return RESULT_OK;
+    }
+    
+    Result Atlas::AddSprites(istream& stream)
+    {
+        if (packed)
+            return RESULT_INVALID_SPRITE;
+        while (stream.peek() != char_traits<char>::eof())
+        {
+            string name;
+            uint32_t* pixels;
+            int width, height;
+            if (!ReadPixelFrame(stream, name, &pixels, &width, &height))
+                return RESULT_LOAD_FAILED;
+            bitmaps.push_back(new Bitmap(pixels, width, height, name, options.premultiply, options.trim));
+        }
+        return RESULT_OK;
+    }
+    
+    Result Atlas::Pack()
+    {
+        if (packed)
+            return RESULT_OK;
+        if (!IsValid(options))
+            return RESULT_INVALID_OPTIONS;
+        
+        //Sort the bitmaps by area, the packers take the largest first
+        sort(bitmaps.begin(), bitmaps.end(), [](const Bitmap* a, const Bitmap* b) {
+            return (a->width * a->height) < (b->width * b->height);
+        });
+        
+        while (!bitmaps.empty())
+        {
+            auto packer = new Packer(options.width, options.height, options.padding << options.mips, GetAlign(options));
+            packer->Pack(bitmaps, false, options.unique, options.rotate);
+            packers.push_back(packer);
+            if (packer->bitmaps.empty())
+            {
+                //Hand the sprites back, so the atlas is the same as before the call
+                for (Packer* failed : packers)
+                {
+                    bitmaps.insert(bitmaps.end(), failed->bitmaps.begin(), failed->bitmaps.end());
+                    delete failed;
+                }
+                packers.clear();
+                return RESULT_PACK_FAILED;
+            }
+        }
+        packed = true;
+        return RESULT_OK;
+    }
+    
+    int Atlas::GetPageCount() const
+    {
+        return packed ? static_cast<int>(packers.size()) : 0;
+    }
+    
+    Result Atlas::GetPageSize(int page, int& width, int& height) const
+    {
+        if (!packed)
+            return RESULT_NOT_PACKED;
+        if (page < 0 || page >= static_cast<int>(packers.size()))
+            return RESULT_OUT_OF_RANGE;
+        width = packers[page]->width;
+        height = packers[page]->height;
+        return RESULT_OK;
+    }
+    
+    int Atlas::GetSpriteCount() const
+    {
+        int count = 0;
+        if (packed)
+            for (const Packer* packer : packers)
+                count += static_cast<int>(packer->bitmaps.size());
+        return count;
+    }
+    
+    Result Atlas::GetSprite(int index, Sprite& sprite) const
+    {
+        if (!packed)
+            return RESULT_NOT_PACKED;
+        if (index < 0)
+            return RESULT_OUT_OF_RANGE;
+        
+        //Sprites are numbered page by page, in the same order as the binary formats
+        for (size_t i = 0; i < packers.size(); ++i)
+        {
+            const Packer* packer = packers[i];
+            if (index >= static_cast<int>(packer->bitmaps.size()))
+            {
+                index -= static_cast<int>(packer->bitmaps.size());
+                continue;
+            }
+            const Bitmap* bitmap = packer->bitmaps[index];
+            const Point& point = packer->points[index];
+            sprite.name = bitmap->name;
+            sprite.page = static_cast<int>(i);
+            sprite.x = point.x;
+            sprite.y = point.y;
+            sprite.width = bitmap->width;
+            sprite.height = bitmap->height;
+            sprite.frameX = bitmap->frameX;
+            sprite.frameY = bitmap->frameY;
+            sprite.frameWidth = bitmap->frameW;
+            sprite.frameHeight = bitmap->frameH;
+            sprite.rotated = point.rot;
+            return RESULT_OK;
+        }
+        return RESULT_OUT_OF_RANGE;
+    }
+    
+    Result Atlas::EncodePage(int page, vector<unsigned char>& out) const
+    {
+        if (!packed)
+            return RESULT_NOT_PACKED;
+        if (page < 0 || page >= static_cast<int>(packers.size()))
+            return RESULT_OUT_OF_RANGE;
+        
+        Bitmap bitmap(packers[page]->width, packers[page]->height);
+        packers[page]->Render(bitmap);
+        if (options.imageFormat == IMAGE_PNG || options.imageFormat == IMAGE_QOI)
+            return bitmap.Encode(out, options.imageFormat == IMAGE_QOI, options.palette) ? RESULT_OK : RESULT_ENCODE_FAILED;
+        
+        Texture texture(bitmap, options.premultiply);
+        texture.GenerateMips(options.mips);
+        switch (options.pixelFormat)
+        {
+            case PIXELS_BC1: texture.Compress(TEXTURE_BC1, options.bestQuality); break;
+            case PIXELS_BC3: texture.Compress(TEXTURE_BC3, options.bestQuality); break;
+            case PIXELS_BC7: texture.Compress(TEXTURE_BC7, options.bestQuality); break;
+            case PIXELS_ETC2: texture.Compress(TEXTURE_ETC2, options.bestQuality); break;
+            default: break;
+        }
+        
+        DitherMode dither = options.dithering == DITHERING_ORDERED ? DITHER_ORDERED : options.dithering == DITHERING_FLOYD_STEINBERG ? DITHER_FLOYD_STEINBERG : DITHER_NONE;
+        switch (options.pixelFormat)
+        {
+            case PIXELS_RGBA4444: texture.Convert(TEXTURE_RGBA4444, dither); break;
+            case PIXELS_RGB565: texture.Convert(TEXTURE_RGB565, dither); break;
+            case PIXELS_RGBA5551: texture.Convert(TEXTURE_RGBA5551, dither); break;
+            default: break;
+        }
+        
+        bool encoded;
+        if (options.imageFormat == IMAGE_KTX2)
+            encoded = EncodeKtx2(out, texture);
+        else if (options.imageFormat == IMAGE_DDS)
+            encoded = EncodeDds(out, texture);
+        else
+            encoded = EncodeRaw(out, texture, options.lz4);
+        return encoded ? RESULT_OK : RESULT_ENCODE_FAILED;
+    }
+    
+    Result Atlas::EncodeData(DataFormat format, const string& name, vector<unsigned char>& out, int page) const
+    {
+        if (!packed)
+            return RESULT_NOT_PACKED;
+        
+        out.clear();
+        switch (format)
+        {
+            case DATA_XML:
+            case DATA_JSON:
+            {
+                ostringstream stream;
+                {
+                    TextWriter writer(stream);
+                    if (format == DATA_XML)
+                    {
+                        writer << "<atlas>\n";
+                        for (size_t i = 0; i < packers.size(); ++i)
+                            packers[i]->SaveXml(name + to_string(i), writer, options.trim, options.rotate);
+                        writer << "</atlas>";
+                    }
+                    else
+                    {
+                        if (page < 0 || page >= static_cast<int>(packers.size()))
+                            return RESULT_OUT_OF_RANGE;
+                        string atlasName = packers.size() > 1 ? name + to_string(page) : name;
+                        packers[page]->SaveJson(atlasName + "_atlas", writer, options.trim, options.rotate, options.jsonCompact, options.jsonColumns);
+                    }
+                    writer.Flush();
+                }
+                string text = stream.str();
+                out.assign(text.begin(), text.end());
+                return RESULT_OK;
+            }
+            case DATA_BINARY:
+            {
+                if (packers.size() > INT16_MAX)
+                    return RESULT_ENCODE_FAILED;
+                for (const Packer* packer : packers)
+                    if (packer->bitmaps.size() > INT16_MAX)
+                        return RESULT_ENCODE_FAILED;
+                size_t size = 2;
+                for (size_t i = 0; i < packers.size(); ++i)
+                    size += packers[i]->GetBinSize(name + to_string(i), options.trim, options.rotate);
+                out.reserve(size);
+                WriteShort(out, static_cast<int16_t>(packers.size()));
+                for (size_t i = 0; i < packers.size(); ++i)
+                    packers[i]->SaveBin(name + to_string(i), out, options.trim, options.rotate);
+                return RESULT_OK;
+            }
+            case DATA_BINARY_V2:
+                return EncodeAtlasBin(out, name, packers, options.trim, options.rotate) ? RESULT_OK : RESULT_ENCODE_FAILED;
+            case DATA_SOA:
+                return EncodeAtlasSoa(out, packers) ? RESULT_OK : RESULT_ENCODE_FAILED;
+        }
+        return RESULT_INVALID_OPTIONS;
+    }
+    
+    const char* GetResultString(Result result)
+    {
+        switch (result)
+        {
+            case RESULT_OK: return "ok";
+            case RESULT_INVALID_OPTIONS: return "invalid options";
+            case RESULT_INVALID_SPRITE: return "invalid sprite";
+            case RESULT_LOAD_FAILED: return "failed to load image";
+            case RESULT_PACK_FAILED: return "packing failed, a sprite does not fit on a page";
+            case RESULT_NOT_PACKED: return "the atlas has not been packed";
+            case RESULT_OUT_OF_RANGE: return "page or sprite index out of range";
+            case RESULT_ENCODE_FAILED: return "encoding failed";
+        }
+        return "unknown result";
+    }
+}
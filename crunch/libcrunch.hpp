@@ -0,0 +1,198 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ libcrunch.hpp - packing atlases from inside another program
+ ============================================================
+ 
+ Link against libcrunch to pack sprites without spawning the crunch
+ executable. Sprites can be passed as RGBA pixels straight from memory
+ or a stream, and pages and atlas data are encoded into buffers instead
+ of files, so nothing touches the disk unless the caller writes it. The
+ pixels go through the same premultiply and trim as images loaded from
+ files. Every Atlas keeps its own state, so separate atlases can be
+ built on separate threads. Nothing here exits the process; failures are
+ returned as a Result.
+ 
+    crunch::Options options;
+    options.trim = true;
+    crunch::Atlas atlas(options);
+    atlas.AddSprite("player/idle0", pixels, 32, 32);
+    if (atlas.Pack() == crunch::RESULT_OK)
+    {
+        vector<unsigned char> png, json;
+        atlas.EncodePage(0, png);
+        atlas.EncodeData(crunch::DATA_JSON, "player", json, 0);
+    }
+ */
+
+#ifndef libcrunch_hpp
+#define libcrunch_hpp
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <cstdint>
+
+using namespace std;
+
+struct Bitmap;
+struct Packer;
+
+namespace crunch
+{
+    enum Result
+    {
+        RESULT_OK,
+        RESULT_INVALID_OPTIONS,
+        RESULT_INVALID_SPRITE,
+        RESULT_LOAD_FAILED,
+        RESULT_PACK_FAILED,
+        RESULT_NOT_PACKED,
+        RESULT_OUT_OF_RANGE,
+        RESULT_ENCODE_FAILED
+    };
+    
+    //Same as --format
+    enum ImageFormat
+    {
+        IMAGE_PNG,
+        IMAGE_QOI,
+        IMAGE_KTX2,
+        IMAGE_DDS,
+        IMAGE_RAW
+    };
+    
+    //Same as --xml, --json, --binary (with --bin-version) and --soa
+    enum DataFormat
+    {
+        DATA_XML,
+        DATA_JSON,
+        DATA_BINARY,
+        DATA_BINARY_V2,
+        DATA_SOA
+    };
+    
+    //Same as --compress and --pixel-format, only one of them can be used at once
+    enum PixelFormat
+    {
+        PIXELS_RGBA8,
+        PIXELS_BC1,
+        PIXELS_BC3,
+        PIXELS_BC7,
+        PIXELS_ETC2,
+        PIXELS_RGBA4444,
+        PIXELS_RGB565,
+        PIXELS_RGBA5551
+    };
+    
+    //Same as --dither
+    enum Dithering
+    {
+        DITHERING_NONE,
+        DITHERING_ORDERED,
+        DITHERING_FLOYD_STEINBERG
+    };
+    
+    //The command line options that affect packing and encoding, with the same defaults
+    struct Options
+    {
+        int width;
+        int height;
+        int padding;
+        bool premultiply;
+        bool trim;
+        bool unique;
+        bool rotate;
+        ImageFormat imageFormat;
+        PixelFormat pixelFormat;
+        Dithering dithering;
+        int mips;
+        bool bestQuality;
+        bool lz4;
+        bool palette;
+        bool jsonCompact;
+        bool jsonColumns;
+        Options();
+    };
+    
+    //Where a sprite ended up, the frame fields are the same as fx, fy, fw and fh in the xml
+    struct Sprite
+    {
+        string name;
+        int page;
+        int x;
+        int y;
+        int width;
+        int height;
+        int frameX;
+        int frameY;
+        int frameWidth;
+        int frameHeight;
+        bool rotated;
+    };
+    
+    struct Atlas
+    {
+        Atlas(const Options& options);
+        ~Atlas();
+        Atlas(const Atlas&) = delete;
+        Atlas& operator=(const Atlas&) = delete;
+        
+        //Copies width * height RGBA pixels, 4 bytes each in R, G, B, A order
+        Result AddSprite(const string& name, const unsigned char* rgba, int width, int height);
+        
+        //Loads a png or qoi file
+        Result AddSprite(const string& name, const string& file);
+        
+        //Adds every frame of a raw pixel stream until it ends, in the format crunch reads
+        //from stdin with -i -
+        Result AddSprites(istream& stream);
+        
+        //Packs every sprite added so far onto as many pages as they need, after which
+        //no more sprites can be added
+        Result Pack();
+        
+        int GetPageCount() const;
+        Result GetPageSize(int page, int& width, int& height) const;
+        int GetSpriteCount() const;
+        Result GetSprite(int index, Sprite& sprite) const;
+        
+        //Renders a page and encodes it in the image and pixel format of the options
+        Result EncodePage(int page, vector<unsigned char>& out) const;
+        
+        //Encodes the layout of every page, named like the command line names them after
+        //the output prefix. Json describes one page at a time, so it only encodes page.
+        Result EncodeData(DataFormat format, const string& name, vector<unsigned char>& out, int page = 0) const;
+        
+    private:
+        Options options;
+        vector<Bitmap*> bitmaps;
+        vector<Packer*> packers;
+        bool packed;
+    };
+    
+    const char* GetResultString(Result result);
+}
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+#include "lz4.hpp"
+#include <cstring>
+#include <cstdint>
+
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MF_LIMIT 12
+#define LZ4_MAX_OFFSET 65535
+#define LZ4_HASH_BITS 16
+
+static inline uint32_t Read32(const unsigned char* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t Lz4Hash(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+static void WriteLength(vector<unsigned char>& out, size_t len)
+{
+    while (len >= 255)
+    {
+        out.push_back(255);
+        len -= 255;
+    }
+    out.push_back(static_cast<unsigned char>(len));
+}
+
+static void WriteSequence(vector<unsigned char>& out, const unsigned char* literals, size_t numLiterals, size_t offset, size_t matchLen)
+{
+    size_t ml = matchLen >= LZ4_MIN_MATCH ? matchLen - LZ4_MIN_MATCH : 0;
+    unsigned char token = static_cast<unsigned char>((numLiterals < 15 ? numLiterals : 15) << 4);
+    if (matchLen > 0)
+        token |= static_cast<unsigned char>(ml < 15 ? ml : 15);
+    out.push_back(token);
+    if (numLiterals >= 15)
+        WriteLength(out, numLiterals - 15);
+    out.insert(out.end(), literals, literals + numLiterals);
+    if (matchLen > 0)
+    {
+        out.push_back(static_cast<unsigned char>(offset & 0xff));
+        out.push_back(static_cast<unsigned char>(offset >> 8));
+        if (ml >= 15)
+            WriteLength(out, ml - 15);
+    }
+}
+
+void Lz4Compress(const unsigned char* src, size_t size, vector<unsigned char>& out)
+{
+    out.reserve(out.size() + size + size / 255 + 16);
+    
+    size_t anchor = 0;
+    if (size > LZ4_MF_LIMIT)
+    {
+        vector<uint32_t> table(1 << LZ4_HASH_BITS, 0);
+        size_t matchLimit = size - LZ4_LAST_LITERALS;
+        size_t i = 1;
+        while (i + LZ4_MF_LIMIT <= size)
+        {
+            uint32_t seq = Read32(src + i);
+            uint32_t h = Lz4Hash(seq);
+            size_t ref = table[h];
+            table[h] = static_cast<uint32_t>(i);
+            
+            if (ref >= i || i - ref > LZ4_MAX_OFFSET || Read32(src + ref) != seq)
+            {
+                ++i;
+                continue;
+            }
+            
+            //Extend the match backwards over pending literals, then forwards
+            while (i > anchor && ref > 0 && src[i - 1] == src[ref - 1])
+            {
+                --i;
+                --ref;
+            }
+            size_t len = LZ4_MIN_MATCH;
+            while (i + len < matchLimit && src[i + len] == src[ref + len])
+                ++len;
+            
+            WriteSequence(out, src + anchor, i - anchor, i - ref, len);
+            i += len;
+            anchor = i;
+            
+            if (i + LZ4_MF_LIMIT <= size)
+                table[Lz4Hash(Read32(src + i - 2))] = static_cast<uint32_t>(i - 2);
+        }
+    }
+    
+    //The block always ends with a literal-only sequence
+    WriteSequence(out, src + anchor, size - anchor, 0, 0);
+}
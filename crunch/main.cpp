@@ -27,6 +27,9 @@
  
  usage:
     crunch -o <OUTPUT_PREFIX> -i <INPUT_DIR1,INPUT_DIR2,...> [OPTIONS...]
+    crunch --batch <FILE> [OPTIONS...]
+ 
+ an input of - reads raw RGBA frames from stdin instead of image files
  
  example:
     crunch -o bin/atlases/atlas -i assets/characters,assets/tiles -p -t -v -u -r
@@ -36,14 +39,31 @@
     -x  --xml               saves the atlas data as a .xml file
     -b  --binary            saves the atlas data as a .bin file
     -j  --json              saves the atlas data as a .json file
+        --soa               saves the sprite data as arrays in a .soa file
     -p  --premultiply       premultiplies the pixels of the bitmaps by their alpha channel
     -t  --trim              trims excess transparency off the bitmaps
     -v  --verbose           print to the debug console as the packer works
     -f  --force             ignore the hash, forcing the packer to repack
     -u  --unique            remove duplicate bitmaps from the atlas
     -r  --rotate            enabled rotating bitmaps 90 degrees clockwise when packing
-    -s# --size#             max atlas size (# can be 4096, 2048, 1024, 512, 256, 128, or 64)
+    -s# --size#             max atlas size, # or #x# for width and height (64 to 16384, default 4096)
     -p# --pad#              padding between images (# can be from 0 to 16)
+        --format <FMT>      atlas image format (png, qoi, ktx2, dds or raw, default png)
+        --lz4               compress raw pages with lz4
+        --compress <FMT>    block compress ktx2/dds/raw pages (bc1, bc3, bc7 or etc2)
+        --quality <Q>       etc2 compression quality (fast or best, default fast)
+        --pixel-format <F>  store ktx2/dds/raw pages as rgba8, rgba4444, rgb565 or rgba5551 (default rgba8)
+        --dither <D>        dithering for 16-bit pixel formats (none, ordered or fs, default none)
+        --palette           save png pages as 8-bit indexed color, quantizing to 256 colors if needed
+        --bin-version <N>   format of the .bin file (1 or 2, default 1)
+        --json-compact      write json without any whitespace
+        --json-columns      write json sprite fields as parallel arrays instead of one object per sprite
+        --incremental       keep unchanged sprites where the previous run placed them
+        --grid <GRID>       slice every image into sprites on a grid of WxH[,MARGIN[,SPACING]] cells
+        --scales <LIST>     also save the atlas at smaller scales from the same layout, like 1,0.5,0.25
+        --scale-filter <F>  filter for --scales (box or lanczos, default box)
+        --mips <N>          add N mip levels to ktx2/dds/raw pages, keeping sprites apart down to the last one
+        --watch             rebuild the atlas whenever one of its images changes (linux only)
  
  binary format:
     [int16] num_textures (below block is repeated this many times)
@@ -59,6 +79,67 @@
             [int16] img_frame_width     (if --trim enabled)
             [int16] img_frame_height    (if --trim enabled)
             [byte] img_rotated          (if --rotate enabled)
+ 
+ binary format version 2 (--bin-version 2, little-endian, sections 16-byte aligned):
+    [char4] "CRAB"
+    [uint32] version             (2)
+    [uint32] header_size         (64)
+    [uint32] flags               (1 = --trim, 2 = --rotate)
+    [uint32] file_size
+    [uint32] num_pages
+    [uint32] num_sprites
+    [uint32] pages_offset
+    [uint32] sprites_offset
+    [uint32] sprite_stride       (48)
+    [uint32] strings_offset
+    [uint32] strings_size
+    [uint32] hash_offset         (0 if there is no name index)
+    [uint32] hash_buckets
+    [uint32] hash_slots
+    [uint32] reserved
+    page record (24 bytes, repeated num_pages times):
+        [uint32] name_offset, name_length (into the string table)
+        [uint32] width, height
+        [uint32] first_sprite, num_sprites
+    sprite record (48 bytes, repeated num_sprites times, grouped by page):
+        [uint32] name_offset, name_length (into the string table)
+        [uint32] page
+        [uint32] x, y, width, height
+        [int32] frame_x, frame_y
+        [uint32] frame_width, frame_height
+        [uint32] flags           (1 = rotated)
+    name index (at hash_offset):
+        [int32 * hash_buckets] displacements
+        [uint32 * hash_slots] sprite index of each slot
+    string table: names, each followed by a null terminator
+ 
+ struct of arrays format (--soa, little-endian, arrays 16-byte aligned, sprites in .bin order):
+    [char4] "CRSA"
+    [uint32] version             (1)
+    [uint32] header_size         (80)
+    [uint32] file_size
+    [uint32] num_pages
+    [uint32] num_sprites
+    [uint32] offsets of: page_sizes, page, x, y, width, height, frame_x, frame_y, frame_width, frame_height, rotated, uvs
+    [uint32 * 2] reserved
+    [uint32 * 2 * num_pages] page_sizes (width, height)
+    [uint32 * num_sprites] page, x, y, width, height
+    [int32 * num_sprites] frame_x, frame_y
+    [uint32 * num_sprites] frame_width, frame_height
+    [uint32 * ceil(num_sprites / 32)] rotated bitset
+    [float32 * 8 * num_sprites] uvs (top left, top right, bottom right, bottom left u/v of the unrotated sprite)
+ 
+ raw page format (--format raw, little-endian):
+    [char4] "CRAW"
+    [uint32] version             (1)
+    [uint32] vk_format           (VkFormat of the pixels, 37 = R8G8B8A8_UNORM, 2/4/6 = R4G4B4A4/R5G6B5/R5G5B5A1_UNORM_PACK16, 133/137/145 = BC1/BC3/BC7, 151 = ETC2)
+    [uint32] width
+    [uint32] height
+    [uint32] num_levels
+    [uint32] compression         (0 = none, 1 = lz4 block)
+    [uint32] flags               (1 = premultiplied alpha)
+    [uint64 * 3] offset, size, uncompressed_size (repeated num_levels times)
+    pixel data for each level, tightly packed rows, each level 16-byte aligned
  */
 
 #include <iostream>
@@ -68,28 +149,73 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <unordered_map>
+#include <mutex>
+#include <cctype>
+#include <chrono>
+#include <atomic>
+#include <cmath>
 #include "tinydir.h"
 #include "bitmap.hpp"
 #include "packer.hpp"
 #include "binary.hpp"
+#include "atlas.hpp"
 #include "hash.hpp"
+#include "manifest.hpp"
 #include "str.hpp"
+#include "texture.hpp"
+#include "parallel.hpp"
+#include "watch.hpp"
+#include "slice.hpp"
+#include "scale.hpp"
+
+#if defined _MSC_VER || defined __MINGW32__
+#include <io.h>
+#include <fcntl.h>
+#endif
 
 using namespace std;
 
-static int optSize;
-static int optPadding;
-static bool optXml;
-static bool optBinary;
-static bool optJson;
-static bool optPremultiply;
-static bool optTrim;
-static bool optVerbose;
-static bool optForce;
-static bool optUnique;
-static bool optRotate;
-static vector<Bitmap*> bitmaps;
-static vector<Packer*> packers;
+//Everything below describes the atlas being built, and is kept per thread so a batch
+//can build several atlases at once
+static thread_local int optWidth;
+static thread_local int optHeight;
+static thread_local int optPadding;
+static thread_local bool optXml;
+static thread_local bool optBinary;
+static thread_local bool optJson;
+static thread_local bool optPremultiply;
+static thread_local bool optTrim;
+static thread_local bool optVerbose;
+static thread_local bool optForce;
+static thread_local bool optUnique;
+static thread_local bool optRotate;
+static thread_local string optFormat;
+static thread_local bool optLz4;
+static thread_local string optCompress;
+static thread_local string optQuality;
+static thread_local string optPixelFormat;
+static thread_local string optDither;
+static thread_local bool optPalette;
+static thread_local int optBinaryVersion;
+static thread_local bool optJsonCompact;
+static thread_local bool optJsonColumns;
+static thread_local bool optSoa;
+static thread_local bool optIncremental;
+static thread_local SliceGrid optGrid;
+
+//A scale from --scales, the images are shrunk by a whole divisor
+struct Scale
+{
+    string name;
+    int divisor;
+};
+static thread_local vector<Scale> optScales;
+static thread_local string optScaleFilter;
+static thread_local int optMips;
+static thread_local vector<Bitmap*> bitmaps;
+static thread_local vector<Packer*> packers;
+static const char* imageFormats[] = { "png", "qoi", "ktx2", "dds", "raw" };
 
 static void SplitFileName(const string& path, string* dir, string* name, string* ext)
 {
@@ -127,15 +253,163 @@ static string GetFileName(const string& path)
     return name;
 }
 
-static void LoadBitmap(const string& prefix, const string& path)
+//Bitmaps already decoded by another atlas of the same batch or an earlier build in watch
+//mode, by file and the options that change their pixels
+struct CachedBitmap
+{
+    size_t fileHash;
+    Bitmap* bitmap;
+};
+static bool useBitmapCache = false;
+static mutex bitmapCacheMutex;
+static unordered_map<string, CachedBitmap> bitmapCache;
+
+//Content hashes of the input files in watch mode, where a file is only read again after
+//the watcher reports it changed
+static bool useFileHashes = false;
+static FileHashes fileHashes;
+
+//Cuts a sheet into sprites named after the sheet, by the rects of its sidecar if it has them
+//or else by the grid. Empty grid cells, like the end of the last row, are left out.
+static bool LoadSheet(const string& name, const string& path, const SliceGrid& grid, vector<Slice>& slices)
+{
+    uint32_t* pixels;
+    int w, h;
+    if (!LoadPixels(path, &pixels, &w, &h))
+    {
+        cerr << "failed to load sheet: " << path << endl;
+        return false;
+    }
+    bool skipEmpty = slices.empty();
+    if (skipEmpty)
+        GetGridSlices(grid, w, h, slices);
+    
+    size_t count = bitmaps.size();
+    for (const Slice& slice : slices)
+    {
+        if (!IsSliceInside(slice, w, h))
+        {
+            cerr << "slice " << slice.name << " is outside of the sheet: " << path << endl;
+            free(pixels);
+            return false;
+        }
+        uint32_t* copy = CopySlice(pixels, w, slice, skipEmpty);
+        if (copy != nullptr)
+            bitmaps.push_back(new Bitmap(copy, slice.width, slice.height, name + "/" + slice.name, optPremultiply, optTrim));
+    }
+    free(pixels);
+    if (optVerbose)
+        cout << "\t\tsliced into " << (bitmaps.size() - count) << " images" << endl;
+    return true;
+}
+
+//Loads an image file, or returns false after printing why it couldn't
+static bool LoadBitmap(const string& prefix, const string& path)
 {
     if (optVerbose)
         cout << '\t' << path << endl;
     
-    bitmaps.push_back(new Bitmap(path, prefix + GetFileName(path), optPremultiply, optTrim));
+    string name = prefix + GetFileName(path);
+    
+    //Sheets are decoded once and sliced in memory, the cache only holds whole images
+    SliceGrid grid = optGrid;
+    vector<Slice> slices;
+    string sliceFile = GetSliceFile(path);
+    bool sidecar = static_cast<bool>(ifstream(sliceFile));
+    if (sidecar && !LoadSlices(sliceFile, grid, slices))
+    {
+        cerr << "invalid slices: " << sliceFile << endl;
+        return false;
+    }
+    if (grid.width > 0 || !slices.empty())
+        return LoadSheet(name, path, grid, slices);
+    
+    if (!useBitmapCache)
+    {
+        Bitmap* bitmap = new Bitmap(path, name, optPremultiply, optTrim);
+        if (bitmap->data == nullptr)
+        {
+            delete bitmap;
+            return false;
+        }
+        bitmaps.push_back(bitmap);
+        return true;
+    }
+    
+    //Reading the file again to see if it changed is much cheaper than decoding it
+    size_t fileHash = 0;
+    if (!HashFile(fileHash, path, useFileHashes ? &fileHashes : nullptr))
+        return false;
+    string key = string(optPremultiply ? "p" : "-") + (optTrim ? "t" : "-") + path;
+    {
+        lock_guard<mutex> lock(bitmapCacheMutex);
+        auto it = bitmapCache.find(key);
+        if (it != bitmapCache.end() && it->second.fileHash == fileHash)
+        {
+            bitmaps.push_back(new Bitmap(*it->second.bitmap, name));
+            return true;
+        }
+    }
+    
+    //Decoding happens outside the lock, if two atlases race for a file both decode it
+    Bitmap* bitmap = new Bitmap(path, name, optPremultiply, optTrim);
+    if (bitmap->data == nullptr)
+    {
+        delete bitmap;
+        return false;
+    }
+    {
+        lock_guard<mutex> lock(bitmapCacheMutex);
+        auto result = bitmapCache.emplace(key, CachedBitmap{ fileHash, nullptr });
+        if (result.first->second.bitmap == nullptr || result.first->second.fileHash != fileHash)
+        {
+            delete result.first->second.bitmap;
+            result.first->second.fileHash = fileHash;
+            result.first->second.bitmap = new Bitmap(*bitmap, name);
+        }
+    }
+    bitmaps.push_back(bitmap);
+    return true;
+}
+
+//Stdin can only be read once, so only one atlas in a process can use it
+static atomic<bool> stdinUsed(false);
+
+//Loads the frames of a raw pixel stream from stdin, hashing them as they come in since
+//there is no file to hash
+static bool LoadStdinBitmaps(size_t& hash)
+{
+    if (stdinUsed.exchange(true))
+    {
+        cerr << "stdin can only be read by one atlas" << endl;
+        return false;
+    }
+#if defined _MSC_VER || defined __MINGW32__
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+    
+    while (cin.peek() != EOF)
+    {
+        string name;
+        uint32_t* pixels;
+        int w, h;
+        if (!ReadPixelFrame(cin, name, &pixels, &w, &h))
+        {
+            cerr << "invalid frame in stdin after " << bitmaps.size() << " images" << endl;
+            return false;
+        }
+        if (optVerbose)
+            cout << "\t<stdin> " << name << endl;
+        HashString(hash, name);
+        HashCombine(hash, static_cast<size_t>(w));
+        HashCombine(hash, static_cast<size_t>(h));
+        HashData(hash, reinterpret_cast<char*>(pixels), sizeof(uint32_t) * w * h);
+        bitmaps.push_back(new Bitmap(pixels, w, h, name, optPremultiply, optTrim));
+    }
+    return true;
 }
 
-static void LoadBitmaps(const string& root, const string& prefix)
+static bool LoadBitmaps(const string& root, const string& prefix)
 {
     static string dot1 = ".";
     static string dot2 = "..";
@@ -145,94 +419,746 @@ static void LoadBitmaps(const string& root, const string& prefix)
     // tinydir_open on Windows (with UNICODE) expects const wchar_t*.
     if (tinydir_open(&dir, StrToPath(root).c_str()) == -1) {
         cerr << "Error opening directory: " << root << endl;
-        return;
+        return true;
     }
     
-    while (dir.has_next)
+    bool loaded = true;
+    while (dir.has_next && loaded)
     {
         tinydir_file file;
         tinydir_readfile(&dir, &file);
         
-        // file.name, file.path, file.extension are TCHAR[] (wchar_t[] on Windows UNICODE)
-        // Convert them back to std::string using PathToStr
-        string current_file_name = PathToStr(file.name);
-        string current_file_path = PathToStr(file.path);
-        string current_file_ext = PathToStr(file.extension);
-
-        if (file.is_dir)
+        // file.name, file.path, file.extension are TCHAR[] (wchar_t[] on Windows UNICODE)
+        // Convert them back to std::string using PathToStr
+        string current_file_name = PathToStr(file.name);
+        string current_file_path = PathToStr(file.path);
+        string current_file_ext = PathToStr(file.extension);
+
+        if (file.is_dir)
+        {
+            if (dot1 != current_file_name && dot2 != current_file_name)
+                loaded = LoadBitmaps(current_file_path, prefix + current_file_name + "/");
+        }
+        else if (IsBitmapExtension(current_file_ext)) // PathToStr(file.extension) gives "png"
+            loaded = LoadBitmap(prefix, current_file_path);
+        
+        tinydir_next(&dir);
+    }
+    
+    tinydir_close(&dir);
+    return loaded;
+}
+
+static void RemoveFile(string file)
+{
+    remove(file.data());
+}
+
+//Every output is written to a hidden temp file next to it, and only moved into place
+//once all of them were written, so a reader never sees a partial or missing atlas
+struct OutputFile
+{
+    string file;
+    size_t hash;
+    bool hashed;
+};
+static thread_local vector<OutputFile> outputFiles;
+
+//What the previous run wrote, and what this run has written or kept so far
+static thread_local Manifest oldManifest;
+static thread_local Manifest newManifest;
+
+static string GetTempFile(const string& file)
+{
+    size_t slash = file.find_last_of("/\\");
+    size_t start = slash == string::npos ? 0 : slash + 1;
+    return file.substr(0, start) + ".~" + file.substr(start);
+}
+
+static string GetManifestName(const string& file)
+{
+    size_t slash = file.find_last_of("/\\");
+    return slash == string::npos ? file : file.substr(slash + 1);
+}
+
+//Files whose hash is not known up front are hashed from their written content
+static string AddOutputFile(const string& file)
+{
+    outputFiles.push_back({ file, 0, false });
+    return GetTempFile(file);
+}
+
+static string AddOutputFile(const string& file, size_t hash)
+{
+    outputFiles.push_back({ file, hash, true });
+    return GetTempFile(file);
+}
+
+//If the previous run wrote the same content to this file, it is left untouched
+static bool KeepOutputFile(const string& file, size_t hash)
+{
+    const ManifestFile* old = oldManifest.Find(GetManifestName(file));
+    if (optForce || old == nullptr || old->hash != hash || !ifstream(file))
+        return false;
+    newManifest.Add(GetManifestName(file), hash);
+    return true;
+}
+
+static void DiscardOutputFiles()
+{
+    for (const OutputFile& output : outputFiles)
+        RemoveFile(GetTempFile(output.file));
+    outputFiles.clear();
+}
+
+static bool CommitOutputFiles()
+{
+    for (size_t i = 0; i < outputFiles.size(); ++i)
+    {
+        string tempFile = GetTempFile(outputFiles[i].file);
+        size_t hash = outputFiles[i].hash;
+        if (!outputFiles[i].hashed)
+        {
+            if (!HashFile(hash, tempFile))
+            {
+                outputFiles.erase(outputFiles.begin(), outputFiles.begin() + i);
+                return false;
+            }
+            if (KeepOutputFile(outputFiles[i].file, hash))
+            {
+                RemoveFile(tempFile);
+                continue;
+            }
+        }
+        if (!RenameFile(tempFile, outputFiles[i].file))
+        {
+            cerr << "failed to replace: " << outputFiles[i].file << endl;
+            outputFiles.erase(outputFiles.begin(), outputFiles.begin() + i);
+            return false;
+        }
+        newManifest.Add(GetManifestName(outputFiles[i].file), hash);
+    }
+    outputFiles.clear();
+    return true;
+}
+
+static void RemoveStaleFile(const string& file)
+{
+    if (newManifest.Find(GetManifestName(file)) == nullptr)
+        RemoveFile(file);
+}
+
+//How long the inputs have to be quiet in watch mode before the atlas is built again
+#define WATCH_DEBOUNCE_MILLISECONDS 100
+
+//Incremental packs fall back to a full pack once their pages are this much emptier than
+//they were after the last full pack
+#define INCREMENTAL_MAX_FRAGMENTATION 0.1
+
+//The smallest scale --scales accepts is one over this
+#define SCALE_MAX_DIVISOR 16
+
+//The smallest number that every scale divides into a whole number
+static int GetScaleMultiple()
+{
+    int multiple = 1;
+    for (const Scale& scale : optScales)
+    {
+        int a = multiple, b = scale.divisor;
+        while (b != 0)
+        {
+            int t = a % b;
+            a = b;
+            b = t;
+        }
+        multiple = multiple / a * scale.divisor;
+    }
+    return multiple;
+}
+
+//Compressed pages need placements on 4 texel blocks, --scales needs them to stay on whole
+//(and block aligned) texels at every scale, and --mips needs them on the same texel at
+//every level, so sprites never share a texel or a block with each other
+static int GetPackAlign()
+{
+    return (optCompress.empty() ? 1 : 4) * GetScaleMultiple() * (1 << optMips);
+}
+
+//Padding at full size that still leaves the requested padding at the smallest scale or
+//mip level; placements are on multiples of the divisor, so it only has to grow with it
+static int GetPackPadding()
+{
+    int largest = 1;
+    for (const Scale& scale : optScales)
+        largest = max(largest, scale.divisor);
+    return (largest << optMips) * optPadding;
+}
+
+static Packer* NewPacker()
+{
+    return new Packer(optWidth, optHeight, GetPackPadding(), GetPackAlign());
+}
+
+//Shrinks every packed image and its placement by a divisor of the scale multiple
+static vector<Packer*> ScalePackers(int divisor)
+{
+    vector<Bitmap*> sources;
+    vector<bool> rotated;
+    for (const Packer* packer : packers)
+    {
+        sources.insert(sources.end(), packer->bitmaps.begin(), packer->bitmaps.end());
+        for (const Point& point : packer->points)
+            rotated.push_back(point.rot);
+    }
+    
+    //The options are thread_local, so the workers get copies of them
+    vector<Bitmap*> scaled(sources.size());
+    ScaleFilter filter = optScaleFilter == "lanczos" ? SCALE_LANCZOS : SCALE_BOX;
+    bool premultiplied = optPremultiply;
+    ParallelFor(static_cast<int>(sources.size()), [&](int i) {
+        const Bitmap* source = sources[i];
+        int w, h;
+        uint32_t* pixels;
+        if (rotated[i])
+        {
+            //Shrink the image the way it lies in the atlas, then turn it back, so an odd
+            //size rounds up on the same side as at full size
+            Bitmap turned(source->height, source->width);
+            turned.CopyPixelsRot(source, 0, 0);
+            uint32_t* shrunk = DownsamplePixels(turned.data, turned.width, turned.height, divisor, filter, premultiplied, &h, &w);
+            pixels = reinterpret_cast<uint32_t*>(malloc(sizeof(uint32_t) * w * h));
+            for (int y = 0; y < h; ++y)
+                for (int x = 0; x < w; ++x)
+                    pixels[size_t(y) * w + x] = shrunk[size_t(x) * h + (h - 1 - y)];
+            free(shrunk);
+        }
+        else
+            pixels = DownsamplePixels(source->data, source->width, source->height, divisor, filter, premultiplied, &w, &h);
+        Bitmap* bitmap = new Bitmap(pixels, w, h, source->name, false, false);
+        bitmap->frameX = source->frameX / divisor;
+        bitmap->frameY = source->frameY / divisor;
+        bitmap->frameW = (source->frameW + divisor - 1) / divisor;
+        bitmap->frameH = (source->frameH + divisor - 1) / divisor;
+        scaled[i] = bitmap;
+    });
+    
+    vector<Packer*> pages;
+    size_t index = 0;
+    for (const Packer* packer : packers)
+    {
+        Packer* page = new Packer(packer->width / divisor, packer->height / divisor, optPadding, 1);
+        for (const Point& point : packer->points)
+        {
+            Point p = point;
+            p.x /= divisor;
+            p.y /= divisor;
+            page->points.push_back(p);
+            page->bitmaps.push_back(scaled[index++]);
+        }
+        pages.push_back(page);
+    }
+    return pages;
+}
+
+static void ClearPackers()
+{
+    for (Packer* packer : packers)
+        delete packer;
+    packers.clear();
+}
+
+//Frees whatever the previous atlas built on this thread, and resets its state
+static void ClearAtlas()
+{
+    for (Packer* packer : packers)
+        for (Bitmap* bitmap : packer->bitmaps)
+            delete bitmap;
+    ClearPackers();
+    for (Bitmap* bitmap : bitmaps)
+        delete bitmap;
+    bitmaps.clear();
+    outputFiles.clear();
+    oldManifest = Manifest();
+    newManifest = Manifest();
+}
+
+static double GetOccupancy()
+{
+    double used = 0.0;
+    double total = 0.0;
+    for (const Packer* packer : packers)
+    {
+        used += packer->GetUsedArea();
+        total += static_cast<double>(packer->width) * packer->height;
+    }
+    return total > 0.0 ? used / total : 0.0;
+}
+
+//Packs the remaining bitmaps onto new pages
+static bool PackBitmaps(const string& name)
+{
+    while (!bitmaps.empty())
+    {
+        if (optVerbose)
+            cout << "packing " << bitmaps.size() << " images..." << endl;
+        auto packer = NewPacker();
+        packer->Pack(bitmaps, optVerbose, optUnique, optRotate);
+        packers.push_back(packer);
+        if (optVerbose)
+            cout << "finished packing: " << name << to_string(packers.size() - 1) << " (" << packer->width << " x " << packer->height << ')' << endl;
+    
+        if (packer->bitmaps.empty())
+        {
+            cerr << "packing failed, could not fit bitmap: " << (bitmaps.back())->name << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+//Keeps every sprite that still has the same size where the previous run placed it, then
+//packs the new and resized ones into the space around them; bitmaps that don't fit on
+//the previous pages are left for PackBitmaps
+static bool PackIncremental()
+{
+    unordered_map<string, const ManifestSprite*> layout;
+    size_t pages = 0;
+    for (const ManifestSprite& sprite : oldManifest.sprites)
+    {
+        layout.emplace(sprite.name, &sprite);
+        pages = max(pages, static_cast<size_t>(sprite.page) + 1);
+    }
+    
+    //More pages than images would leave one of them empty, so the layout can't be kept
+    if (pages > bitmaps.size())
+        return false;
+    for (size_t i = 0; i < pages; ++i)
+        packers.push_back(NewPacker());
+    
+    //Go from largest to smallest like a full pack does, so the sprites stay in the same order
+    vector<Bitmap*> added;
+    for (auto bi = bitmaps.rbegin(); bi != bitmaps.rend(); ++bi)
+    {
+        auto it = layout.find((*bi)->name);
+        const ManifestSprite* sprite = it != layout.end() ? it->second : nullptr;
+        if (sprite == nullptr || sprite->width != (*bi)->width || sprite->height != (*bi)->height ||
+            !packers[sprite->page]->Keep(*bi, sprite->x, sprite->y, sprite->rot, optUnique))
+            added.push_back(*bi);
+    }
+    if (optVerbose)
+        cout << "kept " << (bitmaps.size() - added.size()) << " images in place" << endl;
+    bitmaps.assign(added.rbegin(), added.rend());
+    
+    for (size_t i = 0; i < packers.size(); ++i)
+    {
+        if (packers[i]->bitmaps.empty() && bitmaps.empty())
+            return false;
+        if (optVerbose && !bitmaps.empty())
+            cout << "packing " << bitmaps.size() << " images around them..." << endl;
+        packers[i]->Pack(bitmaps, optVerbose, optUnique, optRotate);
+        if (packers[i]->bitmaps.empty())
+            return false;
+    }
+    return true;
+}
+
+static bool ParsePackSize(const string& str, int* size)
+{
+    if (str.empty() || str.size() > 5 || !all_of(str.begin(), str.end(), [](char c) { return isdigit(static_cast<unsigned char>(c)) != 0; }))
+        return false;
+    *size = stoi(str);
+    return *size >= PACKER_MIN_SIZE && *size <= PACKER_MAX_SIZE;
+}
+
+//Either one size for square pages or WIDTHxHEIGHT
+static bool GetPackSize(const string& str, int* width, int* height)
+{
+    size_t x = str.find('x');
+    if (x == string::npos ? ParsePackSize(str, width) && ParsePackSize(str, height) : ParsePackSize(str.substr(0, x), width) && ParsePackSize(str.substr(x + 1), height))
+        return true;
+    cerr << "invalid size: " << str << endl;
+    return false;
+}
+
+static bool GetPadding(const string& str, int* padding)
+{
+    for (int i = 0; i <= 16; ++i)
+    {
+        if (str == to_string(i))
+        {
+            *padding = i;
+            return true;
+        }
+    }
+    cerr << "invalid padding value: " << str << endl;
+    return false;
+}
+
+static bool GetFormat(const string& str, string* format)
+{
+    for (const char* name : imageFormats)
+    {
+        if (str == name)
+        {
+            *format = str;
+            return true;
+        }
+    }
+    cerr << "invalid format: " << str << endl;
+    return false;
+}
+
+static bool GetCompression(const string& str, string* compression)
+{
+    if (str == "bc1" || str == "bc3" || str == "bc7" || str == "etc2")
+    {
+        *compression = str;
+        return true;
+    }
+    cerr << "invalid compression: " << str << endl;
+    return false;
+}
+
+static bool GetQuality(const string& str, string* quality)
+{
+    if (str == "fast" || str == "best")
+    {
+        *quality = str;
+        return true;
+    }
+    cerr << "invalid quality: " << str << endl;
+    return false;
+}
+
+static bool GetPixelFormat(const string& str, string* format)
+{
+    if (str == "rgba8" || str == "rgba4444" || str == "rgb565" || str == "rgba5551")
+    {
+        *format = str;
+        return true;
+    }
+    cerr << "invalid pixel format: " << str << endl;
+    return false;
+}
+
+static bool GetGrid(const string& str, SliceGrid* grid)
+{
+    if (ParseSliceGrid(str, *grid))
+        return true;
+    cerr << "invalid grid: " << str << endl;
+    return false;
+}
+
+//Every scale has to be one over a whole number, so the layout can be divided exactly
+static bool GetScales(const string& str, vector<Scale>* scales)
+{
+    scales->clear();
+    stringstream ss(str);
+    string item;
+    while (getline(ss, item, ','))
+    {
+        char* end;
+        double value = strtod(item.c_str(), &end);
+        double divisor = value > 0.0 ? 1.0 / value : 0.0;
+        int rounded = static_cast<int>(divisor + 0.5);
+        if (item.empty() || *end != '\0' || value > 1.0 || rounded < 1 || rounded > SCALE_MAX_DIVISOR || fabs(divisor - rounded) > 0.01)
+        {
+            cerr << "invalid scale, it has to be 1 over a whole number up to " << SCALE_MAX_DIVISOR << ": " << item << endl;
+            return false;
+        }
+        for (const Scale& scale : *scales)
+        {
+            if (scale.divisor == rounded)
+            {
+                cerr << "duplicate scale: " << item << endl;
+                return false;
+            }
+        }
+        scales->push_back({ item, rounded });
+    }
+    if (scales->empty())
+    {
+        cerr << "invalid scales: " << str << endl;
+        return false;
+    }
+    return true;
+}
+
+static bool GetScaleFilter(const string& str, string* filter)
+{
+    if (str == "box" || str == "lanczos")
+    {
+        *filter = str;
+        return true;
+    }
+    cerr << "invalid scale filter: " << str << endl;
+    return false;
+}
+
+static bool GetMips(const string& str, int* mips)
+{
+    int count = 0;
+    if (!str.empty() && str.size() <= 2 && all_of(str.begin(), str.end(), [](char c) { return isdigit(static_cast<unsigned char>(c)) != 0; }))
+        count = stoi(str);
+    if (count < 1 || count > PACKER_MAX_MIPS)
+    {
+        cerr << "invalid mip count: " << str << endl;
+        return false;
+    }
+    *mips = count;
+    return true;
+}
+
+static bool GetDither(const string& str, string* dither)
+{
+    if (str == "none" || str == "ordered" || str == "fs")
+    {
+        *dither = str;
+        return true;
+    }
+    cerr << "invalid dither: " << str << endl;
+    return false;
+}
+
+static bool GetBinaryVersion(const string& str, int* version)
+{
+    if (str == "1" || str == "2")
+    {
+        *version = stoi(str);
+        return true;
+    }
+    cerr << "invalid binary version: " << str << endl;
+    return false;
+}
+
+static bool GetValue(const vector<string>& args, size_t& i, string* value)
+{
+    if (i + 1 >= args.size())
+    {
+        cerr << "Error: " << args[i] << " option requires a value." << endl;
+        return false;
+    }
+    *value = args[++i];
+    return true;
+}
+
+static bool SavePage(Bitmap& bitmap, const string& file)
+{
+    if (optFormat == "png" || optFormat == "qoi")
+        return bitmap.SaveAs(file, optPalette);
+    
+    Texture texture(bitmap, optPremultiply);
+    texture.GenerateMips(optMips);
+    bool best = optQuality == "best";
+    if (optCompress == "bc1")
+        texture.Compress(TEXTURE_BC1, best);
+    else if (optCompress == "bc3")
+        texture.Compress(TEXTURE_BC3, best);
+    else if (optCompress == "bc7")
+        texture.Compress(TEXTURE_BC7, best);
+    else if (optCompress == "etc2")
+        texture.Compress(TEXTURE_ETC2, best);
+    
+    DitherMode dither = optDither == "ordered" ? DITHER_ORDERED : optDither == "fs" ? DITHER_FLOYD_STEINBERG : DITHER_NONE;
+    if (optPixelFormat == "rgba4444")
+        texture.Convert(TEXTURE_RGBA4444, dither);
+    else if (optPixelFormat == "rgb565")
+        texture.Convert(TEXTURE_RGB565, dither);
+    else if (optPixelFormat == "rgba5551")
+        texture.Convert(TEXTURE_RGBA5551, dither);
+    
+    bool saved;
+    if (optFormat == "ktx2")
+        saved = SaveKtx2(texture, file);
+    else if (optFormat == "dds")
+        saved = SaveDds(texture, file);
+    else
+        saved = SaveRaw(texture, file, optLz4);
+    if (!saved)
+    {
+        cerr << "failed to save " << optFormat << ": " << file << endl;
+        return false;
+    }
+    return true;
+}
+
+//Writes the pages and data files of an atlas
+static bool SaveAtlas(const string& outputDir, const string& name, const vector<Packer*>& pages, size_t optionsHash)
+{
+    //Save the atlas image
+    for (size_t i = 0; i < pages.size(); ++i)
+    {
+        string currentImageFileName = outputDir + name;
+        if (pages.size() > 1)
+        {
+            currentImageFileName += to_string(i);
+        }
+        currentImageFileName += "." + optFormat;
+
+        Bitmap bitmap(pages[i]->width, pages[i]->height);
+        pages[i]->Render(bitmap);
+        size_t pageHash = optionsHash;
+        HashCombine(pageHash, static_cast<size_t>(bitmap.width));
+        HashCombine(pageHash, static_cast<size_t>(bitmap.height));
+        HashData(pageHash, reinterpret_cast<char*>(bitmap.data), sizeof(uint32_t) * bitmap.width * bitmap.height);
+        if (KeepOutputFile(currentImageFileName, pageHash))
+        {
+            if (optVerbose)
+                cout << "unchanged " << optFormat << ": " << currentImageFileName << endl;
+            continue;
+        }
+        
+        if (optVerbose)
+            cout << "writing " << optFormat << ": " << currentImageFileName << endl;
+        if (!SavePage(bitmap, AddOutputFile(currentImageFileName, pageHash)))
+            return false;
+    }
+    
+    //Save the atlas binary
+    if (optBinary)
+    {
+        if (optVerbose)
+            cout << "writing bin: " << outputDir << name << ".bin" << endl;
+        
+        if (optBinaryVersion == 2)
+        {
+            bool indexed = true;
+            if (!SaveAtlasBin(AddOutputFile(outputDir + name + ".bin"), name, pages, optTrim, optRotate, &indexed))
+            {
+                cerr << "failed to save bin: " << outputDir << name << ".bin" << endl;
+                return false;
+            }
+            if (!indexed)
+                cout << "could not build name index, lookups will have to search: " << name << endl;
+        }
+        else
+        {
+            if (pages.size() > INT16_MAX)
+            {
+                cerr << "too many pages for a version 1 bin, use --bin-version 2: " << pages.size() << endl;
+                return false;
+            }
+            for (size_t i = 0; i < pages.size(); ++i)
+            {
+                if (pages[i]->bitmaps.size() > INT16_MAX)
+                {
+                    cerr << "too many images on page " << i << " for a version 1 bin, use --bin-version 2: " << pages[i]->bitmaps.size() << endl;
+                    return false;
+                }
+            }
+            
+            //Serialize everything into one buffer and write it in one go
+            size_t size = 2;
+            for (size_t i = 0; i < pages.size(); ++i)
+                size += pages[i]->GetBinSize(name + to_string(i), optTrim, optRotate);
+            vector<unsigned char> bin;
+            bin.reserve(size);
+            WriteShort(bin, (int16_t)pages.size());
+            for (size_t i = 0; i < pages.size(); ++i)
+                pages[i]->SaveBin(name + to_string(i), bin, optTrim, optRotate);
+            if (!WriteFile(AddOutputFile(outputDir + name + ".bin"), bin))
+            {
+                cerr << "failed to save bin: " << outputDir << name << ".bin" << endl;
+                return false;
+            }
+        }
+    }
+    
+    //Save the sprite arrays
+    if (optSoa)
+    {
+        if (optVerbose)
+            cout << "writing soa: " << outputDir << name << ".soa" << endl;
+        
+        if (!SaveAtlasSoa(AddOutputFile(outputDir + name + ".soa"), pages))
+        {
+            cerr << "failed to save soa: " << outputDir << name << ".soa" << endl;
+            return false;
+        }
+    }
+    
+    //Save the atlas xml
+    if (optXml)
+    {
+        if (optVerbose)
+            cout << "writing xml: " << outputDir << name << ".xml" << endl;
+        
+        ofstream xmlFile(AddOutputFile(outputDir + name + ".xml"));
+        TextWriter xml(xmlFile);
+        xml << "<atlas>\n";
+        for (size_t i = 0; i < pages.size(); ++i)
+            pages[i]->SaveXml(name + to_string(i), xml, optTrim, optRotate);
+        xml << "</atlas>";
+        xml.Flush();
+        xmlFile.close();
+        if (!xmlFile)
         {
-            if (dot1 != current_file_name && dot2 != current_file_name)
-                LoadBitmaps(current_file_path, prefix + current_file_name + "/");
+            cerr << "failed to save xml: " << outputDir << name << ".xml" << endl;
+            return false;
         }
-        else if (current_file_ext == "png") // PathToStr(file.extension) gives "png"
-            LoadBitmap(prefix, current_file_path);
-        
-        tinydir_next(&dir);
     }
     
-    tinydir_close(&dir);
-}
-
-static void RemoveFile(string file)
-{
-    remove(file.data());
-}
+    //Save the atlas json
+    if (optJson)
+    {
+        for (size_t i = 0; i < pages.size(); ++i)
+        {
+            string currentJsonFileName = outputDir + name;
+            string currentAtlasNameBase = name;
 
-static int GetPackSize(const string& str)
-{
-    if (str == "4096")
-        return 4096;
-    if (str == "2048")
-        return 2048;
-    if (str == "1024")
-        return 1024;
-    if (str == "512")
-        return 512;
-    if (str == "256")
-        return 256;
-    if (str == "128")
-        return 128;
-    if (str == "64")
-        return 64;
-    cerr << "invalid size: " << str << endl;
-    exit(EXIT_FAILURE);
-    return 0;
-}
+            if (pages.size() > 1)
+            {
+                currentJsonFileName += to_string(i);
+                currentAtlasNameBase += to_string(i);
+            }
+            currentJsonFileName += ".json";
+            string internalAtlasName = currentAtlasNameBase + "_atlas";
 
-static int GetPadding(const string& str)
-{
-    for (int i = 0; i <= 16; ++i)
-        if (str == to_string(i))
-            return i;
-    cerr << "invalid padding value: " << str << endl;
-    exit(EXIT_FAILURE);
-    return 1;
+            if (optVerbose)
+                cout << "writing json: " << currentJsonFileName << " (Atlas Name: " << internalAtlasName << ")" << endl;
+            
+            ofstream jsonFile(AddOutputFile(currentJsonFileName));
+            if (!jsonFile.is_open())
+            {
+                cerr << "Failed to open json file for writing: " << currentJsonFileName << endl;
+                return false;
+            }
+            TextWriter json(jsonFile);
+            pages[i]->SaveJson(internalAtlasName, json, optTrim, optRotate, optJsonCompact, optJsonColumns);
+            json.Flush();
+            jsonFile.close();
+            if (!jsonFile)
+            {
+                cerr << "failed to save json: " << currentJsonFileName << endl;
+                return false;
+            }
+        }
+    }
+    return true;
 }
 
-int main(int argc, const char* argv[])
+//Builds one atlas from its command line arguments
+static int Crunch(const vector<string>& args)
 {
-    //Print out passed arguments
-    for (int i = 0; i < argc; ++i)
-        cout << argv[i] << ' ';
-    cout << endl;
-
+    ClearAtlas();
+    
     string rawOutputPathStr; // Store the raw path first
     string rawInputPathStr;  // Store the raw path first
     vector<string> cli_options;
 
-    for (int i = 1; i < argc; ++i) {
-        string arg = argv[i];
+    for (size_t i = 0; i < args.size(); ++i) {
+        const string& arg = args[i];
         if (arg == "-o") {
-            if (i + 1 < argc) {
-                rawOutputPathStr = argv[++i];
+            if (i + 1 < args.size()) {
+                rawOutputPathStr = args[++i];
             } else {
                 cerr << "Error: -o option requires a value." << endl;
                 // Usage string will be printed by the later check
                 return EXIT_FAILURE;
             }
         } else if (arg == "-i") {
-            if (i + 1 < argc) {
-                rawInputPathStr = argv[++i];
+            if (i + 1 < args.size()) {
+                rawInputPathStr = args[++i];
             } else {
                 cerr << "Error: -i option requires a value." << endl;
                 // Usage string will be printed by the later check
@@ -243,7 +1169,7 @@ int main(int argc, const char* argv[])
         }
     }
 
-    string usage_string = "usage:\n   crunch -o <OUTPUT_PREFIX> -i <INPUT_DIR1,INPUT_DIR2,...> [OPTIONS...]\n\nexample:\n   crunch -o bin/atlases/atlas -i assets/characters,assets/tiles -p -t -v -u -r\n\noptions:\n   -d  --default           use default settings (-x -p -t -u)\n   -x  --xml               saves the atlas data as a .xml file\n   -b  --binary            saves the atlas data as a .bin file\n   -j  --json              saves the atlas data as a .json file\n   -p  --premultiply       premultiplies the pixels of the bitmaps by their alpha channel\n   -t  --trim              trims excess transparency off the bitmaps\n   -v  --verbose           print to the debug console as the packer works\n   -f  --force             ignore the hash, forcing the packer to repack\n   -u  --unique            remove duplicate bitmaps from the atlas\n   -r  --rotate            enabled rotating bitmaps 90 degrees clockwise when packing\n   -s# --size#             max atlas size (# can be 4096, 2048, 1024, 512, 256, 128, or 64)\n   -p# --pad#              padding between images (# can be from 0 to 16)";
+    string usage_string = "usage:\n   crunch -o <OUTPUT_PREFIX> -i <INPUT_DIR1,INPUT_DIR2,...> [OPTIONS...]\n   crunch --batch <FILE> [OPTIONS...]\n\nan input of - reads raw RGBA frames from stdin instead of image files\n\nexample:\n   crunch -o bin/atlases/atlas -i assets/characters,assets/tiles -p -t -v -u -r\n\noptions:\n   -d  --default           use default settings (-x -p -t -u)\n   -x  --xml               saves the atlas data as a .xml file\n   -b  --binary            saves the atlas data as a .bin file\n   -j  --json              saves the atlas data as a .json file\n       --soa               saves the sprite data as arrays in a .soa file\n   -p  --premultiply       premultiplies the pixels of the bitmaps by their alpha channel\n   -t  --trim              trims excess transparency off the bitmaps\n   -v  --verbose           print to the debug console as the packer works\n   -f  --force             ignore the hash, forcing the packer to repack\n   -u  --unique            remove duplicate bitmaps from the atlas\n   -r  --rotate            enabled rotating bitmaps 90 degrees clockwise when packing\n   -s# --size#             max atlas size, # or #x# for width and height (64 to 16384, default 4096)\n   -p# --pad#              padding between images (# can be from 0 to 16)\n       --format <FMT>      atlas image format (png, qoi, ktx2, dds or raw, default png)\n       --lz4               compress raw pages with lz4\n       --compress <FMT>    block compress ktx2/dds/raw pages (bc1, bc3, bc7 or etc2)\n       --quality <Q>       etc2 compression quality (fast or best, default fast)\n       --pixel-format <F>  store ktx2/dds/raw pages as rgba8, rgba4444, rgb565 or rgba5551 (default rgba8)\n       --dither <D>        dithering for 16-bit pixel formats (none, ordered or fs, default none)\n       --palette           save png pages as 8-bit indexed color, quantizing to 256 colors if needed\n       --bin-version <N>   format of the .bin file (1 or 2, default 1)\n       --json-compact      write json without any whitespace\n       --json-columns      write json sprite fields as parallel arrays instead of one object per sprite\n       --incremental       keep unchanged sprites where the previous run placed them\n       --grid <GRID>       slice every image into sprites on a grid of WxH[,MARGIN[,SPACING]] cells\n       --scales <LIST>     also save the atlas at smaller scales from the same layout, like 1,0.5,0.25\n       --scale-filter <F>  filter for --scales (box or lanczos, default box)\n       --mips <N>          add N mip levels to ktx2/dds/raw pages, keeping sprites apart down to the last one\n       --watch             rebuild the atlas whenever one of its images changes (linux only)";
 
     if (rawOutputPathStr.empty() || rawInputPathStr.empty()) { // Check raw paths
         cerr << "Error: Both -o (output prefix) and -i (input directories) arguments are required." << endl;
@@ -271,7 +1197,9 @@ int main(int argc, const char* argv[])
     {
         string inputStrItem;
         getline(ss, inputStrItem, ',');
-        if (!inputStrItem.empty()) {
+        if (inputStrItem == "-") {
+            inputs.push_back(inputStrItem);
+        } else if (!inputStrItem.empty()) {
             string normalizedInput = NormalizePath(inputStrItem);
             // Ensure input directories end with a slash for consistency.
             // tinydir_open might be fine without it, but LoadBitmaps and HashFiles might expect it.
@@ -289,7 +1217,8 @@ int main(int argc, const char* argv[])
     }
     
     //Get the options
-    optSize = 4096;
+    optWidth = 4096;
+    optHeight = 4096;
     optPadding = 1;
     optXml = false;
     optBinary = false;
@@ -299,8 +1228,28 @@ int main(int argc, const char* argv[])
     optVerbose = false;
     optForce = false;
     optUnique = false;
-    for (const string& arg : cli_options)
+    optRotate = false;
+    optFormat = "png";
+    optLz4 = false;
+    optCompress = "";
+    optQuality = "fast";
+    optPixelFormat = "rgba8";
+    optDither = "none";
+    optPalette = false;
+    optBinaryVersion = 1;
+    optJsonCompact = false;
+    optJsonColumns = false;
+    optSoa = false;
+    optIncremental = false;
+    optGrid = { 0, 0, 0, 0 };
+    optScales.clear();
+    optScaleFilter = "box";
+    optMips = 0;
+    for (size_t i = 0; i < cli_options.size(); ++i)
     {
+        const string& arg = cli_options[i];
+        string value;
+        bool valid = true;
         if (arg == "-d" || arg == "--default")
             optXml = optPremultiply = optTrim = optUnique = true;
         else if (arg == "-x" || arg == "--xml")
@@ -321,19 +1270,106 @@ int main(int argc, const char* argv[])
             optUnique = true;
         else if (arg == "-r" || arg == "--rotate")
             optRotate = true;
+        else if (arg == "--lz4")
+            optLz4 = true;
+        else if (arg == "--palette")
+            optPalette = true;
+        else if (arg == "--json-compact")
+            optJsonCompact = true;
+        else if (arg == "--json-columns")
+            optJsonColumns = true;
+        else if (arg == "--soa")
+            optSoa = true;
+        else if (arg == "--incremental")
+            optIncremental = true;
+        else if (arg == "--grid")
+            valid = GetValue(cli_options, i, &value) && GetGrid(value, &optGrid);
+        else if (arg == "--scales")
+            valid = GetValue(cli_options, i, &value) && GetScales(value, &optScales);
+        else if (arg == "--scale-filter")
+            valid = GetValue(cli_options, i, &value) && GetScaleFilter(value, &optScaleFilter);
+        else if (arg == "--mips")
+            valid = GetValue(cli_options, i, &value) && GetMips(value, &optMips);
+        else if (arg == "--format")
+            valid = GetValue(cli_options, i, &value) && GetFormat(value, &optFormat);
+        else if (arg == "--compress")
+            valid = GetValue(cli_options, i, &value) && GetCompression(value, &optCompress);
+        else if (arg == "--quality")
+            valid = GetValue(cli_options, i, &value) && GetQuality(value, &optQuality);
+        else if (arg == "--pixel-format")
+            valid = GetValue(cli_options, i, &value) && GetPixelFormat(value, &optPixelFormat);
+        else if (arg == "--dither")
+            valid = GetValue(cli_options, i, &value) && GetDither(value, &optDither);
+        else if (arg == "--bin-version")
+            valid = GetValue(cli_options, i, &value) && GetBinaryVersion(value, &optBinaryVersion);
+        else if (arg == "--size" || arg == "-s")
+            valid = GetValue(cli_options, i, &value) && GetPackSize(value, &optWidth, &optHeight);
         else if (arg.find("--size") == 0)
-            optSize = GetPackSize(arg.substr(6));
+            valid = GetPackSize(arg.substr(6), &optWidth, &optHeight);
         else if (arg.find("-s") == 0)
-            optSize = GetPackSize(arg.substr(2));
+            valid = GetPackSize(arg.substr(2), &optWidth, &optHeight);
         else if (arg.find("--pad") == 0)
-            optPadding = GetPadding(arg.substr(5));
+            valid = GetPadding(arg.substr(5), &optPadding);
         else if (arg.find("-p") == 0)
-            optPadding = GetPadding(arg.substr(2));
+            valid = GetPadding(arg.substr(2), &optPadding);
         else
         {
             cerr << "unexpected argument: " << arg << endl;
             return EXIT_FAILURE;
         }
+        if (!valid)
+            return EXIT_FAILURE;
+    }
+    
+    if (optLz4 && optFormat != "raw")
+    {
+        cerr << "--lz4 requires --format raw" << endl;
+        return EXIT_FAILURE;
+    }
+    if (!optCompress.empty() && (optFormat == "png" || optFormat == "qoi"))
+    {
+        cerr << "--compress requires --format ktx2, dds or raw" << endl;
+        return EXIT_FAILURE;
+    }
+    if (!optCompress.empty() && (optWidth % 4 != 0 || optHeight % 4 != 0))
+    {
+        cerr << "--compress requires a size that is a multiple of 4" << endl;
+        return EXIT_FAILURE;
+    }
+    if (optMips > 0 && (optFormat == "png" || optFormat == "qoi"))
+    {
+        cerr << "--mips requires --format ktx2, dds or raw" << endl;
+        return EXIT_FAILURE;
+    }
+    if ((!optScales.empty() || optMips > 0) && (optWidth % GetPackAlign() != 0 || optHeight % GetPackAlign() != 0))
+    {
+        cerr << (optScales.empty() ? "--mips" : optMips > 0 ? "--scales with --mips" : "--scales") << " requires a size that is a multiple of " << GetPackAlign() << endl;
+        return EXIT_FAILURE;
+    }
+    if (optCompress == "etc2" && optFormat == "dds")
+    {
+        cerr << "etc2 can not be saved as dds, use --format ktx2 or raw" << endl;
+        return EXIT_FAILURE;
+    }
+    if (optPixelFormat != "rgba8" && (optFormat == "png" || optFormat == "qoi"))
+    {
+        cerr << "--pixel-format requires --format ktx2, dds or raw" << endl;
+        return EXIT_FAILURE;
+    }
+    if (optPixelFormat != "rgba8" && !optCompress.empty())
+    {
+        cerr << "--pixel-format can not be combined with --compress" << endl;
+        return EXIT_FAILURE;
+    }
+    if (optPalette && optFormat != "png")
+    {
+        cerr << "--palette requires --format png" << endl;
+        return EXIT_FAILURE;
+    }
+    if ((optJsonCompact || optJsonColumns) && !optJson)
+    {
+        cerr << "--json-compact and --json-columns require --json" << endl;
+        return EXIT_FAILURE;
     }
     
     //Hash the arguments and input directories
@@ -357,14 +1393,33 @@ int main(int argc, const char* argv[])
     for (const string& opt : sorted_cli_options) {
         HashString(newHash, opt);
     }
+    
+    //Pages are compared by their pixels and the options they are encoded with
+    size_t optionsHash = 0;
+    for (const string& opt : sorted_cli_options)
+        if (opt != "-v" && opt != "--verbose" && opt != "-f" && opt != "--force")
+            HashString(optionsHash, opt);
 
     // Hash the content of input files/directories (this part remains the same)
     for (size_t i = 0; i < inputs.size(); ++i)
     {
-        if (inputs[i].rfind('.') == string::npos)
-            HashFiles(newHash, inputs[i]);
+        if (inputs[i] == "-")
+        {
+            if (!LoadStdinBitmaps(newHash))
+                return EXIT_FAILURE;
+        }
+        else if (inputs[i].rfind('.') == string::npos)
+        {
+            if (!HashFiles(newHash, inputs[i], useFileHashes ? &fileHashes : nullptr))
+                return EXIT_FAILURE;
+        }
         else
-            HashFile(newHash, inputs[i]);
+        {
+            if (!HashFile(newHash, inputs[i], useFileHashes ? &fileHashes : nullptr))
+                return EXIT_FAILURE;
+            if (ifstream(GetSliceFile(inputs[i])) && !HashFile(newHash, GetSliceFile(inputs[i]), useFileHashes ? &fileHashes : nullptr))
+                return EXIT_FAILURE;
+        }
     }
     
     //Load the old hash
@@ -397,137 +1452,425 @@ int main(int argc, const char* argv[])
         cout << "\t--xml: " << (optXml ? "true" : "false") << endl;
         cout << "\t--binary: " << (optBinary ? "true" : "false") << endl;
         cout << "\t--json: " << (optJson ? "true" : "false") << endl;
+        cout << "\t--soa: " << (optSoa ? "true" : "false") << endl;
         cout << "\t--premultiply: " << (optPremultiply ? "true" : "false") << endl;
         cout << "\t--trim: " << (optTrim ? "true" : "false") << endl;
         cout << "\t--verbose: " << (optVerbose ? "true" : "false") << endl;
         cout << "\t--force: " << (optForce ? "true" : "false") << endl;
         cout << "\t--unique: " << (optUnique ? "true" : "false") << endl;
         cout << "\t--rotate: " << (optRotate ? "true" : "false") << endl;
-        cout << "\t--size: " << optSize << endl;
+        cout << "\t--size: " << optWidth << 'x' << optHeight << endl;
         cout << "\t--pad: " << optPadding << endl;
+        cout << "\t--format: " << optFormat << endl;
+        cout << "\t--lz4: " << (optLz4 ? "true" : "false") << endl;
+        cout << "\t--compress: " << (optCompress.empty() ? "none" : optCompress) << endl;
+        cout << "\t--quality: " << optQuality << endl;
+        cout << "\t--pixel-format: " << optPixelFormat << endl;
+        cout << "\t--dither: " << optDither << endl;
+        cout << "\t--palette: " << (optPalette ? "true" : "false") << endl;
+        cout << "\t--bin-version: " << optBinaryVersion << endl;
+        cout << "\t--json-compact: " << (optJsonCompact ? "true" : "false") << endl;
+        cout << "\t--json-columns: " << (optJsonColumns ? "true" : "false") << endl;
+        cout << "\t--incremental: " << (optIncremental ? "true" : "false") << endl;
+        if (optGrid.width > 0)
+            cout << "\t--grid: " << optGrid.width << 'x' << optGrid.height << ',' << optGrid.margin << ',' << optGrid.spacing << endl;
+        else
+            cout << "\t--grid: none" << endl;
+        cout << "\t--scales: ";
+        for (size_t i = 0; i < optScales.size(); ++i)
+            cout << (i > 0 ? "," : "") << optScales[i].name;
+        cout << (optScales.empty() ? "none" : "") << endl;
+        cout << "\t--scale-filter: " << optScaleFilter << endl;
+        cout << "\t--mips: " << optMips << endl;
     }
     
-    //Remove old files
-    RemoveFile(outputDir + name + ".hash");
-    RemoveFile(outputDir + name + ".bin");
-    RemoveFile(outputDir + name + ".xml");
-    // Remove single json file from previous run
-    RemoveFile(outputDir + name + ".json");
-    // Remove potentially multiple json files from previous run (e.g., atlas0.json, atlas1.json)
-    for (size_t i = 0; i < 16; ++i) // Assuming max 16 pages for cleanup, same as pngs
-    {
-        RemoveFile(outputDir + name + to_string(i) + ".json");
-        RemoveFile(outputDir + name + to_string(i) + ".png");
-    }
+    bool hasOldManifest = LoadManifest(oldManifest, outputDir + name + ".manifest");
     
     //Load the bitmaps from all the input files and directories
     if (optVerbose)
         cout << "loading images..." << endl;
     for (size_t i = 0; i < inputs.size(); ++i)
     {
-        if (inputs[i].rfind('.') != string::npos)
-            LoadBitmap("", inputs[i]);
-        else
-            LoadBitmaps(inputs[i], "");
+        if (inputs[i] == "-")
+            continue;
+        bool loaded = inputs[i].rfind('.') != string::npos ? LoadBitmap("", inputs[i]) : LoadBitmaps(inputs[i], "");
+        if (!loaded)
+            return EXIT_FAILURE;
     }
     
+    //With --scales, trimmed images are widened so they start on a whole texel at every scale
+    if (GetScaleMultiple() > 1)
+        for (Bitmap* bitmap : bitmaps)
+            bitmap->AlignTrim(GetScaleMultiple());
+    
     //Sort the bitmaps by area
     sort(bitmaps.begin(), bitmaps.end(), [](const Bitmap* a, const Bitmap* b) {
         return (a->width * a->height) < (b->width * b->height);
     });
     
-    //Pack the bitmaps
-    while (!bitmaps.empty())
+    //Pack the bitmaps, starting from the previous layout if it was made with the same options
+    vector<Bitmap*> sortedBitmaps = bitmaps;
+    bool incremental = optIncremental && !optForce && oldManifest.layoutHash == optionsHash && !oldManifest.sprites.empty();
+    if (incremental && !PackIncremental())
     {
         if (optVerbose)
-            cout << "packing " << bitmaps.size() << " images..." << endl;
-        auto packer = new Packer(optSize, optSize, optPadding);
-        packer->Pack(bitmaps, optVerbose, optUnique, optRotate);
-        packers.push_back(packer);
+            cout << "previous layout has an empty page, repacking all images..." << endl;
+        ClearPackers();
+        bitmaps = sortedBitmaps;
+        incremental = false;
+    }
+    if (!PackBitmaps(name))
+        return EXIT_FAILURE;
+    
+    //Holes left by removed or resized sprites add up, so start over once too much space is wasted
+    if (incremental && GetOccupancy() < oldManifest.occupancy * (1.0 - INCREMENTAL_MAX_FRAGMENTATION))
+    {
         if (optVerbose)
-            cout << "finished packing: " << name << to_string(packers.size() - 1) << " (" << packer->width << " x " << packer->height << ')' << endl;
+            cout << "layout is too fragmented, repacking all images..." << endl;
+        ClearPackers();
+        bitmaps = sortedBitmaps;
+        incremental = false;
+        if (!PackBitmaps(name))
+            return EXIT_FAILURE;
+    }
     
-        if (packer->bitmaps.empty())
+    //Save the atlas, or one for every scale
+    if (optScales.empty())
+    {
+        if (!SaveAtlas(outputDir, name, packers, optionsHash))
+            return EXIT_FAILURE;
+    }
+    for (const Scale& scale : optScales)
+    {
+        if (scale.divisor == 1)
         {
-            cerr << "packing failed, could not fit bitmap: " << (bitmaps.back())->name << endl;
+            if (!SaveAtlas(outputDir, name, packers, optionsHash))
+                return EXIT_FAILURE;
+            continue;
+        }
+        if (optVerbose)
+            cout << "scaling images to " << scale.name << "..." << endl;
+        vector<Packer*> scaled = ScalePackers(scale.divisor);
+        bool saved = SaveAtlas(outputDir, name + "@" + scale.name + "x", scaled, optionsHash);
+        for (Packer* packer : scaled)
+        {
+            for (Bitmap* bitmap : packer->bitmaps)
+                delete bitmap;
+            delete packer;
+        }
+        if (!saved)
             return EXIT_FAILURE;
+    }
+    
+    //Move everything into place at once
+    if (!CommitOutputFiles())
+        return EXIT_FAILURE;
+    
+    //Remove the files the previous run wrote that this one didn't, such as pages that
+    //are no longer needed or outputs in another format
+    if (hasOldManifest)
+    {
+        for (const ManifestFile& file : oldManifest.files)
+            if (file.name.find_first_of("/\\") == string::npos)
+                RemoveStaleFile(outputDir + file.name);
+    }
+    else
+    {
+        //Runs from before the manifest existed are cleaned up by name, page by page until
+        //one is missing
+        RemoveStaleFile(outputDir + name + ".bin");
+        RemoveStaleFile(outputDir + name + ".soa");
+        RemoveStaleFile(outputDir + name + ".xml");
+        RemoveStaleFile(outputDir + name + ".json");
+        for (const char* format : imageFormats)
+            RemoveStaleFile(outputDir + name + "." + format);
+        for (size_t i = 0, found = 1; found > 0; ++i)
+        {
+            found = 0;
+            vector<string> pageFiles = { outputDir + name + to_string(i) + ".json" };
+            for (const char* format : imageFormats)
+                pageFiles.push_back(outputDir + name + to_string(i) + "." + format);
+            for (const string& file : pageFiles)
+            {
+                if (ifstream(file))
+                {
+                    ++found;
+                    RemoveStaleFile(file);
+                }
+            }
         }
     }
     
-    //Save the atlas image
+    //Save the manifest, so the next run can leave the files that didn't change alone
+    string manifestFile = outputDir + name + ".manifest";
+    newManifest.hash = newHash;
+    newManifest.layoutHash = optionsHash;
+    newManifest.occupancy = incremental ? oldManifest.occupancy : GetOccupancy();
     for (size_t i = 0; i < packers.size(); ++i)
     {
-        string currentPngFileName = outputDir + name;
-        if (packers.size() > 1)
+        for (size_t j = 0; j < packers[i]->bitmaps.size(); ++j)
         {
-            currentPngFileName += to_string(i);
+            const Bitmap* bitmap = packers[i]->bitmaps[j];
+            const Point& point = packers[i]->points[j];
+            newManifest.sprites.push_back({ bitmap->name, static_cast<int>(i), point.x, point.y, bitmap->width, bitmap->height, point.rot });
         }
-        currentPngFileName += ".png";
+    }
+    if (!SaveManifest(newManifest, GetTempFile(manifestFile)) || !RenameFile(GetTempFile(manifestFile), manifestFile))
+    {
+        cerr << "failed to save manifest: " << manifestFile << endl;
+        RemoveFile(GetTempFile(manifestFile));
+        return EXIT_FAILURE;
+    }
+    
+    //Save the new hash last, so it only ever describes outputs that are fully in place
+    string hashFile = outputDir + name + ".hash";
+    SaveHash(newHash, GetTempFile(hashFile));
+    if (!RenameFile(GetTempFile(hashFile), hashFile))
+    {
+        cerr << "failed to save hash: " << hashFile << endl;
+        RemoveFile(GetTempFile(hashFile));
+        return EXIT_FAILURE;
+    }
+    
+    return EXIT_SUCCESS;
+}
 
-        if (optVerbose)
-            cout << "writing png: " << currentPngFileName << endl;
-        packers[i]->SavePng(currentPngFileName);
+//Splits a line of a batch file into arguments, which can be quoted to contain spaces
+static vector<string> SplitArguments(const string& line)
+{
+    vector<string> args;
+    string arg;
+    bool quoted = false;
+    bool started = false;
+    for (char c : line)
+    {
+        if (c == '"')
+        {
+            quoted = !quoted;
+            started = true;
+        }
+        else if (!quoted && isspace(static_cast<unsigned char>(c)))
+        {
+            if (started)
+                args.push_back(arg);
+            arg.clear();
+            started = false;
+        }
+        else
+        {
+            arg += c;
+            started = true;
+        }
     }
+    if (started)
+        args.push_back(arg);
+    return args;
+}
+
+//The total size of the images an atlas is built from, to estimate how long it takes
+static size_t GetInputSize(const string& root)
+{
+    tinydir_dir dir;
+    if (tinydir_open(&dir, StrToPath(root).c_str()) == -1)
+        return 0;
     
-    //Save the atlas binary
-    if (optBinary)
+    size_t size = 0;
+    while (dir.has_next)
     {
-        if (optVerbose)
-            cout << "writing bin: " << outputDir << name << ".bin" << endl;
-        
-        ofstream bin(outputDir + name + ".bin", ios::binary);
-        WriteShort(bin, (int16_t)packers.size());
-        for (size_t i = 0; i < packers.size(); ++i)
-            packers[i]->SaveBin(name + to_string(i), bin, optTrim, optRotate);
-        bin.close();
+        tinydir_file file;
+        tinydir_readfile(&dir, &file);
+        string fileName = PathToStr(file.name);
+        if (file.is_dir)
+        {
+            if (fileName != "." && fileName != "..")
+                size += GetInputSize(PathToStr(file.path));
+        }
+        else if (IsBitmapExtension(PathToStr(file.extension)))
+            size += static_cast<size_t>(file._s.st_size);
+        tinydir_next(&dir);
+    }
+    tinydir_close(&dir);
+    return size;
+}
+
+static size_t GetInputSize(const vector<string>& args)
+{
+    size_t size = 0;
+    for (size_t i = 0; i + 1 < args.size(); ++i)
+    {
+        if (args[i] != "-i")
+            continue;
+        stringstream ss(args[i + 1]);
+        string input;
+        while (getline(ss, input, ','))
+        {
+            if (input.rfind('.') != string::npos)
+                size += static_cast<size_t>(max(ifstream(input, ios::binary | ios::ate).tellg(), streampos(0)));
+            else
+                size += GetInputSize(input);
+        }
+    }
+    return size;
+}
+
+//Builds every atlas listed in a file, one per line with the same arguments as the command
+//line plus any options given after the file. Atlases are built at the same time, biggest
+//first so a large one doesn't start last and hold up the whole batch, and images that
+//several atlases use are only decoded once.
+static int Batch(const string& file, const vector<string>& options)
+{
+    ifstream stream(file);
+    if (!stream)
+    {
+        cerr << "failed to open batch file: " << file << endl;
+        return EXIT_FAILURE;
     }
     
-    //Save the atlas xml
-    if (optXml)
+    vector<vector<string>> jobs;
+    string line;
+    while (getline(stream, line))
     {
-        if (optVerbose)
-            cout << "writing xml: " << outputDir << name << ".xml" << endl;
-        
-        ofstream xml(outputDir + name + ".xml");
-        xml << "<atlas>" << endl;
-        for (size_t i = 0; i < packers.size(); ++i)
-            packers[i]->SaveXml(name + to_string(i), xml, optTrim, optRotate);
-        xml << "</atlas>";
+        vector<string> args = SplitArguments(line);
+        if (args.empty() || args[0][0] == '#')
+            continue;
+        args.insert(args.end(), options.begin(), options.end());
+        jobs.push_back(args);
     }
     
-    //Save the atlas json
-    if (optJson)
+    vector<size_t> sizes;
+    vector<int> order;
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        sizes.push_back(GetInputSize(jobs[i]));
+        order.push_back(static_cast<int>(i));
+    }
+    stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return sizes[a] > sizes[b];
+    });
+    
+    useBitmapCache = true;
+    vector<int> results(jobs.size());
+    ParallelFor(static_cast<int>(jobs.size()), [&](int i) {
+        results[order[i]] = Crunch(jobs[order[i]]);
+        DiscardOutputFiles();
+        ClearAtlas();
+    });
+    
+    int failed = 0;
+    for (size_t i = 0; i < jobs.size(); ++i)
     {
-        for (size_t i = 0; i < packers.size(); ++i)
+        if (results[i] != EXIT_SUCCESS)
         {
-            string currentJsonFileName = outputDir + name;
-            string currentAtlasNameBase = name;
+            cerr << "failed to build atlas " << (i + 1) << " of " << file << endl;
+            ++failed;
+        }
+    }
+    return failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
 
-            if (packers.size() > 1)
-            {
-                currentJsonFileName += to_string(i);
-                currentAtlasNameBase += to_string(i);
-            }
-            currentJsonFileName += ".json";
-            string internalAtlasName = currentAtlasNameBase + "_atlas";
+//Drops the remembered hashes of the files at or under a path the watcher reported, so
+//the next build reads them again. A leading "./" is ignored, since an input in the current
+//directory is watched through "."
+static void ForgetFileHashes(const string& path)
+{
+    auto strip = [](const string& p) { return p.compare(0, 2, "./") == 0 ? p.substr(2) : p; };
+    string changed = strip(path);
+    for (auto it = fileHashes.begin(); it != fileHashes.end();)
+    {
+        string file = strip(it->first);
+        if (file == changed || file.compare(0, changed.size() + 1, changed + "/") == 0)
+            it = fileHashes.erase(it);
+        else
+            ++it;
+    }
+}
 
-            if (optVerbose)
-                cout << "writing json: " << currentJsonFileName << " (Atlas Name: " << internalAtlasName << ")" << endl;
-            
-            ofstream jsonFile(currentJsonFileName);
-            if (!jsonFile.is_open())
+//Builds the atlas, then builds it again whenever one of its images changes. Decoded
+//images stay in memory and the layout is updated incrementally, so a rebuild only pays
+//for the images that changed and the pages they are on, and only the files the watcher
+//reported are read again. A build that fails, like on an image that is still being
+//written, is reported and the next change is waited for as usual.
+static int Watch(vector<string> args)
+{
+    if (find(args.begin(), args.end(), "--incremental") == args.end())
+        args.push_back("--incremental");
+    
+    vector<string> roots;
+    for (size_t i = 0; i + 1 < args.size(); ++i)
+    {
+        if (args[i] != "-i")
+            continue;
+        stringstream ss(args[i + 1]);
+        string input;
+        while (getline(ss, input, ','))
+        {
+            if (input == "-")
             {
-                cerr << "Failed to open json file for writing: " << currentJsonFileName << endl;
-                // Potentially skip or return EXIT_FAILURE
-                continue;
+                cerr << "--watch can not read images from stdin" << endl;
+                return EXIT_FAILURE;
             }
-            packers[i]->SaveJson(internalAtlasName, jsonFile, optTrim, optRotate);
-            jsonFile.close();
+            string dir = input;
+            if (input.rfind('.') != string::npos)
+                SplitFileName(input, &dir, nullptr, nullptr);
+            roots.push_back(dir.empty() ? "." : dir);
         }
     }
     
-    //Save the new hash
-    SaveHash(newHash, outputDir + name + ".hash");
+    //Start watching before the first build, so nothing saved while it runs is missed
+    Watcher watcher;
+    if (!watcher.Open(roots))
+    {
+        cerr << "failed to watch the input directories, --watch requires inotify" << endl;
+        return EXIT_FAILURE;
+    }
     
-    return EXIT_SUCCESS;
+    useBitmapCache = true;
+    useFileHashes = true;
+    while (true)
+    {
+        auto start = chrono::steady_clock::now();
+        int result = Crunch(args);
+        DiscardOutputFiles();
+        auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+        if (result == EXIT_SUCCESS)
+            cout << "built in " << elapsed.count() << "ms, watching for changes..." << endl;
+        else
+            cout << "build failed, watching for changes..." << endl;
+        
+        vector<string> changes;
+        if (!watcher.Wait(WATCH_DEBOUNCE_MILLISECONDS, changes))
+            return EXIT_FAILURE;
+        for (const string& change : changes)
+            ForgetFileHashes(change);
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    //Print out passed arguments
+    for (int i = 0; i < argc; ++i)
+        cout << argv[i] << ' ';
+    cout << endl;
+    
+    vector<string> args(argv + 1, argv + argc);
+    if (!args.empty() && args[0] == "--batch")
+    {
+        if (args.size() < 2)
+        {
+            cerr << "Error: --batch option requires a value." << endl;
+            return EXIT_FAILURE;
+        }
+        return Batch(args[1], vector<string>(args.begin() + 2, args.end()));
+    }
+    auto watch = find(args.begin(), args.end(), "--watch");
+    if (watch != args.end())
+    {
+        args.erase(watch);
+        return Watch(args);
+    }
+    
+    //If anything fails before the outputs are committed, the old ones are left untouched
+    int result = Crunch(args);
+    DiscardOutputFiles();
+    return result;
 }
@@ -0,0 +1,120 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+
+#include "manifest.hpp"
+#include "packer.hpp"
+#include <fstream>
+#include <sstream>
+
+Manifest::Manifest()
+: hash(0), layoutHash(0), occupancy(0)
+{
+    
+}
+
+const ManifestFile* Manifest::Find(const string& name) const
+{
+    for (const ManifestFile& file : files)
+        if (file.name == name)
+            return &file;
+    return nullptr;
+}
+
+void Manifest::Add(const string& name, size_t hash)
+{
+    files.push_back({ name, hash });
+}
+
+//The manifest is a text file with one entry per line:
+//  crunch-manifest <version>
+//  hash <hash>
+//  file <hash> <name>
+//  layout <options hash> <occupancy of the last full pack>
+//  sprite <page> <x> <y> <width> <height> <rotated> <name>
+//A damaged manifest is rejected as a whole and leaves manifest unchanged
+bool LoadManifest(Manifest& result, const string& file)
+{
+    ifstream stream(file);
+    if (!stream)
+        return false;
+    
+    Manifest manifest;
+    string line, type;
+    int version = 0;
+    if (!getline(stream, line) || !(istringstream(line) >> type >> version) || type != "crunch-manifest" || version != MANIFEST_VERSION)
+        return false;
+    
+    while (getline(stream, line))
+    {
+        istringstream ss(line);
+        if (!(ss >> type))
+            continue;
+        if (type == "hash")
+        {
+            if (!(ss >> manifest.hash))
+                return false;
+        }
+        else if (type == "file")
+        {
+            ManifestFile entry;
+            if (!(ss >> entry.hash) || !getline(ss >> ws, entry.name))
+                return false;
+            manifest.files.push_back(entry);
+        }
+        else if (type == "layout")
+        {
+            if (!(ss >> manifest.layoutHash >> manifest.occupancy))
+                return false;
+        }
+        else if (type == "sprite")
+        {
+            ManifestSprite sprite;
+            if (!(ss >> sprite.page >> sprite.x >> sprite.y >> sprite.width >> sprite.height >> sprite.rot) || !getline(ss >> ws, sprite.name))
+                return false;
+            if (sprite.page < 0 || sprite.x < 0 || sprite.y < 0 || sprite.width < 0 || sprite.height < 0 ||
+                sprite.x > PACKER_MAX_SIZE || sprite.y > PACKER_MAX_SIZE || sprite.width > PACKER_MAX_SIZE || sprite.height > PACKER_MAX_SIZE)
+                return false;
+            manifest.sprites.push_back(sprite);
+        }
+    }
+    result = manifest;
+    return true;
+}
+
+bool SaveManifest(const Manifest& manifest, const string& file)
+{
+    ofstream stream(file);
+    stream << "crunch-manifest " << MANIFEST_VERSION << '\n';
+    stream << "hash " << manifest.hash << '\n';
+    for (const ManifestFile& entry : manifest.files)
+        stream << "file " << entry.hash << ' ' << entry.name << '\n';
+    stream << "layout " << manifest.layoutHash << ' ' << manifest.occupancy << '\n';
+    for (const ManifestSprite& sprite : manifest.sprites)
+        stream << "sprite " << sprite.page << ' ' << sprite.x << ' ' << sprite.y << ' ' << sprite.width << ' ' << sprite.height << ' ' << sprite.rot << ' ' << sprite.name << '\n';
+    stream.close();
+    return !stream.fail();
+}
@@ -0,0 +1,74 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+
+#ifndef manifest_hpp
+#define manifest_hpp
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define MANIFEST_VERSION 1
+
+//An output file written by a run, and a hash of the content it was written from
+struct ManifestFile
+{
+    string name;
+    size_t hash;
+};
+
+//Where a sprite was placed, so the next run can keep it there
+struct ManifestSprite
+{
+    string name;
+    int page;
+    int x;
+    int y;
+    int width;
+    int height;
+    bool rot;
+};
+
+//Saved next to the atlas, so the next run knows what the previous one wrote
+struct Manifest
+{
+    size_t hash;
+    size_t layoutHash;
+    double occupancy;
+    vector<ManifestFile> files;
+    vector<ManifestSprite> sprites;
+    
+    Manifest();
+    const ManifestFile* Find(const string& name) const;
+    void Add(const string& name, size_t hash);
+};
+
+bool LoadManifest(Manifest& manifest, const string& file);
+bool SaveManifest(const Manifest& manifest, const string& file);
+
+#endif
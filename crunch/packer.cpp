@@ -30,22 +30,67 @@
 #include "binary.hpp"
 #include <iostream>
 #include <algorithm>
+#include <functional>
 
 using namespace std;
 using namespace rbp;
 
-Packer::Packer(int width, int height, int pad)
-: width(width), height(height), pad(pad)
+static int RoundUp(int value, int multiple)
+{
+    return ((value + multiple - 1) / multiple) * multiple;
+}
+
+Packer::Packer(int width, int height, int pad, int align)
+: width(width), height(height), pad(pad), align(align), usedWidth(0), usedHeight(0), bin(width, height)
 {
     
 }
 
-void Packer::Pack(vector<Bitmap*>& bitmaps, bool verbose, bool unique, bool rotate)
+bool Packer::Keep(Bitmap* bitmap, int x, int y, bool rot, bool unique)
 {
-    MaxRectsBinPack packer(width, height);
+    //A sprite with the same pixels as one kept before it becomes its duplicate, wherever it was
+    if (unique)
+    {
+        auto di = dupLookup.find(bitmap->hashValue);
+        if (di != dupLookup.end() && bitmap->Equals(this->bitmaps[di->second]))
+        {
+            Point p = points[di->second];
+            p.dupID = di->second;
+            points.push_back(p);
+            this->bitmaps.push_back(bitmap);
+            return true;
+        }
+    }
+    
+    int w = RoundUp(bitmap->width + pad, align);
+    int h = RoundUp(bitmap->height + pad, align);
+    Rect rect;
+    rect.x = x;
+    rect.y = y;
+    rect.width = rot ? h : w;
+    rect.height = rot ? w : h;
+    if (!bin.Place(rect))
+        return false;
     
-    int ww = 0;
-    int hh = 0;
+    if (unique)
+        dupLookup[bitmap->hashValue] = static_cast<int>(points.size());
+    
+    Point p;
+    p.x = x;
+    p.y = y;
+    p.dupID = -1;
+    p.rot = rot;
+    
+    points.push_back(p);
+    this->bitmaps.push_back(bitmap);
+    
+    usedWidth = max(rect.x + rect.width, usedWidth);
+    usedHeight = max(rect.y + rect.height, usedHeight);
+    return true;
+}
+
+void Packer::Pack(vector<Bitmap*>& bitmaps, bool verbose, bool unique, bool rotate)
+{
     while (!bitmaps.empty())
     {
         auto bitmap = bitmaps.back();
@@ -70,7 +115,11 @@ void Packer::Pack(vector<Bitmap*>& bitmaps, bool verbose, bool unique, bool rota
         
         //If it's not a duplicate, pack it into the atlas
         {
-            Rect rect = packer.Insert(bitmap->width + pad, bitmap->height + pad, rotate, MaxRectsBinPack::RectBestShortSideFit);
+            //Rounding sizes up to the alignment keeps every placement on an aligned
+            //texel, so compressed blocks never straddle two sprites
+            int w = RoundUp(bitmap->width + pad, align);
+            int h = RoundUp(bitmap->height + pad, align);
+            Rect rect = bin.Insert(w, h, rotate, MaxRectsBinPack::RectBestShortSideFit);
             
             if (rect.width == 0 || rect.height == 0)
                 break;
@@ -83,26 +132,35 @@ void Packer::Pack(vector<Bitmap*>& bitmaps, bool verbose, bool unique, bool rota
             p.x = rect.x;
             p.y = rect.y;
             p.dupID = -1;
-            p.rot = rotate && bitmap->width != (rect.width - pad);
+            p.rot = rotate && w != rect.width;
             
             points.push_back(p);
             this->bitmaps.push_back(bitmap);
             bitmaps.pop_back();
             
-            ww = max(rect.x + rect.width, ww);
-            hh = max(rect.y + rect.height, hh);
+            usedWidth = max(rect.x + rect.width, usedWidth);
+            usedHeight = max(rect.y + rect.height, usedHeight);
         }
     }
     
-    while (width / 2 >= ww)
+    //Sizes that aren't a power of two stop shrinking before they would break the alignment
+    while (width > 1 && width / 2 >= usedWidth && (width / 2) % align == 0)
         width /= 2;
-    while( height / 2 >= hh)
+    while (height > 1 && height / 2 >= usedHeight && (height / 2) % align == 0)
         height /= 2;
 }
 
-void Packer::SavePng(const string& file)
+int Packer::GetUsedArea() const
+{
+    int area = 0;
+    for (size_t i = 0, j = bitmaps.size(); i < j; ++i)
+        if (points[i].dupID < 0)
+            area += bitmaps[i]->width * bitmaps[i]->height;
+    return area;
+}
+
+void Packer::Render(Bitmap& bitmap)
 {
-    Bitmap bitmap(width, height);
     for (size_t i = 0, j = bitmaps.size(); i < j; ++i)
     {
         if (points[i].dupID < 0)
@@ -113,12 +171,18 @@ void Packer::SavePng(const string& file)
                 bitmap.CopyPixels(bitmaps[i], points[i].x, points[i].y);
         }
     }
-    bitmap.SaveAs(file);
 }
 
-void Packer::SaveXml(const string& name, ofstream& xml, bool trim, bool rotate)
+bool Packer::SaveImage(const string& file, bool palette)
 {
-    xml << "\t<tex n=\"" << name << "\">" << endl;
+    Bitmap bitmap(width, height);
+    Render(bitmap);
+    return bitmap.SaveAs(file, palette);
+}
+
+void Packer::SaveXml(const string& name, TextWriter& xml, bool trim, bool rotate)
+{
+    xml << "\t<tex n=\"" << name << "\">\n";
     for (size_t i = 0, j = bitmaps.size(); i < j; ++i)
     {
         xml << "\t\t<img n=\"" << bitmaps[i]->name << "\" ";
@@ -135,12 +199,20 @@ void Packer::SaveXml(const string& name, ofstream& xml, bool trim, bool rotate)
         }
         if (rotate)
             xml << "r=\"" << (points[i].rot ? 1 : 0) << "\" ";
-        xml << "/>" << endl;
+        xml << "/>\n";
     }
-    xml << "\t</tex>" << endl;
+    xml << "\t</tex>\n";
 }
 
-void Packer::SaveBin(const string& name, ofstream& bin, bool trim, bool rotate)
+size_t Packer::GetBinSize(const string& name, bool trim, bool rotate) const
+{
+    size_t size = name.size() + 1 + 2;
+    for (const Bitmap* bitmap : bitmaps)
+        size += bitmap->name.size() + 1 + 8 + (trim ? 8 : 0) + (rotate ? 1 : 0);
+    return size;
+}
+
+void Packer::SaveBin(const string& name, vector<unsigned char>& bin, bool trim, bool rotate)
 {
     WriteString(bin, name);
     WriteShort(bin, (int16_t)bitmaps.size());
@@ -163,46 +235,107 @@ void Packer::SaveBin(const string& name, ofstream& bin, bool trim, bool rotate)
     }
 }
 
-void Packer::SaveJson(const string& atlasName, ofstream& json, bool trim, bool rotate)
+static void Indent(TextWriter& json, int depth, bool compact)
+{
+    if (!compact)
+        for (int i = 0; i < depth; ++i)
+            json << '\t';
+}
+
+void Packer::SaveJson(const string& atlasName, TextWriter& json, bool trim, bool rotate, bool compact, bool columns)
 {
     // The 'trim' parameter is kept for signature consistency with SaveXml/SaveBin,
     // but trim-related fields are now always output in JSON.
     // The 'rotate' parameter is used to determine packed W/H if points[i].rot is true.
-
-    json << "{" << endl;
-    json << "\t\"Name\": \"" << atlasName << "\"," << endl;
-    json << "\t\"Width\": " << this->width << "," << endl;
-    json << "\t\"Height\": " << this->height << "," << endl;
-    json << "\t\"Images\": [" << endl;
+    
+    // Compact mode leaves out all whitespace
+    const char* nl = compact ? "" : "\n";
+    const char* colon = compact ? ":" : ": ";
+    
+    json << "{" << nl;
+    Indent(json, 1, compact);
+    json << "\"Name\"" << colon << "\"" << atlasName << "\"," << nl;
+    Indent(json, 1, compact);
+    json << "\"Width\"" << colon << this->width << "," << nl;
+    Indent(json, 1, compact);
+    json << "\"Height\"" << colon << this->height << "," << nl;
+    Indent(json, 1, compact);
+    
+    if (columns)
+    {
+        // One array per field, indexed by sprite, instead of one object per sprite
+        json << "\"Images\"" << colon << "{" << nl;
+        Indent(json, 2, compact);
+        json << "\"Name\"" << colon << "[";
+        for (size_t i = 0, j = bitmaps.size(); i < j; ++i)
+            json << (i > 0 ? (compact ? "," : ", ") : "") << "\"" << bitmaps[i]->name << ".png\"";
+        json << "]";
+        
+        auto column = [&](const char* field, const function<int(size_t)>& value) {
+            json << "," << nl;
+            Indent(json, 2, compact);
+            json << "\"" << field << "\"" << colon << "[";
+            for (size_t i = 0, j = bitmaps.size(); i < j; ++i)
+                json << (i > 0 ? (compact ? "," : ", ") : "") << value(i);
+            json << "]";
+        };
+        column("X", [&](size_t i) { return points[i].x; });
+        column("Y", [&](size_t i) { return points[i].y; });
+        column("W", [&](size_t i) { return points[i].rot ? bitmaps[i]->height : bitmaps[i]->width; });
+        column("H", [&](size_t i) { return points[i].rot ? bitmaps[i]->width : bitmaps[i]->height; });
+        column("TrimOffsetX", [&](size_t i) { return bitmaps[i]->frameX; });
+        column("TrimOffsetY", [&](size_t i) { return bitmaps[i]->frameY; });
+        column("UntrimmedWidth", [&](size_t i) { return bitmaps[i]->frameW; });
+        column("UntrimmedHeight", [&](size_t i) { return bitmaps[i]->frameH; });
+        json << nl;
+        Indent(json, 1, compact);
+        json << "}" << nl;
+        json << "}" << nl;
+        return;
+    }
+    
+    json << "\"Images\"" << colon << "[" << nl;
 
     for (size_t i = 0, j = bitmaps.size(); i < j; ++i)
     {
-        json << "\t\t{" << endl;
+        Indent(json, 2, compact);
+        json << "{" << nl;
         // Assuming bitmaps[i]->name is "RelativePath/FilenameWithoutExtension"
         // and we need to append ".png" as per example.json.
-        json << "\t\t\t\"Name\": \"" << bitmaps[i]->name << ".png" << "\"," << endl;
-        json << "\t\t\t\"X\": " << points[i].x << "," << endl;
-        json << "\t\t\t\"Y\": " << points[i].y << "," << endl;
+        Indent(json, 3, compact);
+        json << "\"Name\"" << colon << "\"" << bitmaps[i]->name << ".png" << "\"," << nl;
+        Indent(json, 3, compact);
+        json << "\"X\"" << colon << points[i].x << "," << nl;
+        Indent(json, 3, compact);
+        json << "\"Y\"" << colon << points[i].y << "," << nl;
 
         // Calculate packed width and height based on rotation
         int packedW = points[i].rot ? bitmaps[i]->height : bitmaps[i]->width;
         int packedH = points[i].rot ? bitmaps[i]->width : bitmaps[i]->height;
-        json << "\t\t\t\"W\": " << packedW << "," << endl;
-        json << "\t\t\t\"H\": " << packedH << "," << endl;
+        Indent(json, 3, compact);
+        json << "\"W\"" << colon << packedW << "," << nl;
+        Indent(json, 3, compact);
+        json << "\"H\"" << colon << packedH << "," << nl;
 
         // Output trim-related fields with new names, unconditionally
-        json << "\t\t\t\"TrimOffsetX\": " << bitmaps[i]->frameX << "," << endl;
-        json << "\t\t\t\"TrimOffsetY\": " << bitmaps[i]->frameY << "," << endl;
-        json << "\t\t\t\"UntrimmedWidth\": " << bitmaps[i]->frameW << "," << endl;
-        json << "\t\t\t\"UntrimmedHeight\": " << bitmaps[i]->frameH << endl; // Last field, no comma
+        Indent(json, 3, compact);
+        json << "\"TrimOffsetX\"" << colon << bitmaps[i]->frameX << "," << nl;
+        Indent(json, 3, compact);
+        json << "\"TrimOffsetY\"" << colon << bitmaps[i]->frameY << "," << nl;
+        Indent(json, 3, compact);
+        json << "\"UntrimmedWidth\"" << colon << bitmaps[i]->frameW << "," << nl;
+        Indent(json, 3, compact);
+        json << "\"UntrimmedHeight\"" << colon << bitmaps[i]->frameH << nl; // Last field, no comma
 
-        json << "\t\t}";
+        Indent(json, 2, compact);
+        json << "}";
         if (i < j - 1)
         {
             json << ",";
         }
-        json << endl;
+        json << nl;
     }
-    json << "\t]" << endl;
-    json << "}" << endl;
+    Indent(json, 1, compact);
+    json << "]" << nl;
+    json << "}" << nl;
 }
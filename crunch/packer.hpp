@@ -31,9 +31,18 @@
 #include <fstream>
 #include <unordered_map>
 #include "bitmap.hpp"
+#include "textwriter.hpp"
+#include "MaxRectsBinPack.h"
 
 using namespace std;
 
+//Range of page widths and heights
+#define PACKER_MIN_SIZE 64
+#define PACKER_MAX_SIZE 16384
+
+//Most mip levels a page of the largest size can have below it
+#define PACKER_MAX_MIPS 14
+
 struct Point
 {
     int x;
@@ -47,17 +56,25 @@ struct Packer
     int width;
     int height;
     int pad;
+    int align;
+    int usedWidth;
+    int usedHeight;
     
     vector<Bitmap*> bitmaps;
     vector<Point> points;
     unordered_map<size_t, int> dupLookup;
+    rbp::MaxRectsBinPack bin;
     
-    Packer(int width, int height, int pad);
+    Packer(int width, int height, int pad, int align);
+    bool Keep(Bitmap* bitmap, int x, int y, bool rot, bool unique);
     void Pack(vector<Bitmap*>& bitmaps, bool verbose, bool unique, bool rotate);
-    void SavePng(const string& file);
-    void SaveXml(const string& name, ofstream& xml, bool trim, bool rotate);
-    void SaveBin(const string& name, ofstream& bin, bool trim, bool rotate);
-    void SaveJson(const string& name, ofstream& json, bool trim, bool rotate);
+    int GetUsedArea() const;
+    void Render(Bitmap& bitmap);
+    bool SaveImage(const string& file, bool palette);
+    void SaveXml(const string& name, TextWriter& xml, bool trim, bool rotate);
+    size_t GetBinSize(const string& name, bool trim, bool rotate) const;
+    void SaveBin(const string& name, vector<unsigned char>& bin, bool trim, bool rotate);
+    void SaveJson(const string& name, TextWriter& json, bool trim, bool rotate, bool compact, bool columns);
 };
 
 #endif
@@ -0,0 +1,251 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+#include "palette.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <unordered_set>
+
+#define MAX_SAMPLES 65536
+#define KMEANS_ITERATIONS 2
+#define MAP_CHUNK 65536
+#define CACHE_SIZE 4096
+
+static inline int Channel(uint32_t color, int c)
+{
+    return (color >> (c * 8)) & 0xff;
+}
+
+static inline uint32_t Distance(uint32_t a, uint32_t b)
+{
+    uint32_t d = 0;
+    for (int c = 0; c < 4; ++c)
+    {
+        int v = Channel(a, c) - Channel(b, c);
+        d += v * v;
+    }
+    return d;
+}
+
+static size_t Nearest(uint32_t color, const vector<uint32_t>& palette)
+{
+    size_t best = 0;
+    uint32_t bestDist = UINT32_MAX;
+    for (size_t i = 0; i < palette.size() && bestDist > 0; ++i)
+    {
+        uint32_t d = Distance(color, palette[i]);
+        if (d < bestDist)
+        {
+            bestDist = d;
+            best = i;
+        }
+    }
+    return best;
+}
+
+//Collects the distinct colors, giving up once there are more than maxColors
+static bool FindExactColors(const uint32_t* pixels, size_t count, size_t maxColors, bool clearTransparent, vector<uint32_t>& palette)
+{
+    unordered_set<uint32_t> colors;
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t c = pixels[i];
+        if (clearTransparent && (c >> 24) == 0)
+            c = 0;
+        if (colors.insert(c).second && colors.size() > maxColors)
+            return false;
+    }
+    palette.assign(colors.begin(), colors.end());
+    sort(palette.begin(), palette.end());
+    return true;
+}
+
+struct Box
+{
+    size_t begin;
+    size_t end;
+    int channel;
+    int range;
+};
+
+static void MeasureBox(Box& box, const vector<uint32_t>& samples)
+{
+    int lo[4] = { 255, 255, 255, 255 };
+    int hi[4] = { 0, 0, 0, 0 };
+    for (size_t i = box.begin; i < box.end; ++i)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            lo[c] = min(lo[c], Channel(samples[i], c));
+            hi[c] = max(hi[c], Channel(samples[i], c));
+        }
+    }
+    box.channel = 0;
+    box.range = -1;
+    for (int c = 0; c < 4; ++c)
+    {
+        if (hi[c] - lo[c] > box.range)
+        {
+            box.range = hi[c] - lo[c];
+            box.channel = c;
+        }
+    }
+}
+
+static uint32_t Average(const uint64_t sum[4], uint64_t n)
+{
+    uint32_t color = 0;
+    for (int c = 0; c < 4; ++c)
+        color |= static_cast<uint32_t>((sum[c] + n / 2) / n) << (c * 8);
+    return color;
+}
+
+static void MedianCut(vector<uint32_t>& samples, size_t maxColors, vector<uint32_t>& palette)
+{
+    vector<Box> boxes;
+    Box first = { 0, samples.size(), 0, 0 };
+    MeasureBox(first, samples);
+    boxes.push_back(first);
+    
+    //Keep splitting the box with the widest channel at its median
+    while (boxes.size() < maxColors)
+    {
+        size_t split = boxes.size();
+        for (size_t i = 0; i < boxes.size(); ++i)
+            if (boxes[i].end - boxes[i].begin > 1 && boxes[i].range > 0 && (split == boxes.size() || boxes[i].range > boxes[split].range))
+                split = i;
+        if (split == boxes.size())
+            break;
+        
+        Box& box = boxes[split];
+        int channel = box.channel;
+        size_t mid = box.begin + (box.end - box.begin) / 2;
+        nth_element(samples.begin() + box.begin, samples.begin() + mid, samples.begin() + box.end, [=](uint32_t a, uint32_t b) {
+            return Channel(a, channel) < Channel(b, channel);
+        });
+        Box upper = { mid, box.end, 0, 0 };
+        box.end = mid;
+        MeasureBox(box, samples);
+        MeasureBox(upper, samples);
+        boxes.push_back(upper);
+    }
+    
+    for (const Box& box : boxes)
+    {
+        uint64_t sum[4] = { 0, 0, 0, 0 };
+        for (size_t i = box.begin; i < box.end; ++i)
+            for (int c = 0; c < 4; ++c)
+                sum[c] += Channel(samples[i], c);
+        palette.push_back(Average(sum, box.end - box.begin));
+    }
+}
+
+static void RefineKMeans(const vector<uint32_t>& samples, vector<uint32_t>& palette, size_t first)
+{
+    for (int iteration = 0; iteration < KMEANS_ITERATIONS; ++iteration)
+    {
+        vector<uint64_t> sums(palette.size() * 5, 0);
+        for (uint32_t s : samples)
+        {
+            uint64_t* sum = &sums[Nearest(s, palette) * 5];
+            for (int c = 0; c < 4; ++c)
+                sum[c] += Channel(s, c);
+            ++sum[4];
+        }
+        
+        //Reserved entries before first are kept as they are
+        for (size_t i = first; i < palette.size(); ++i)
+            if (sums[i * 5 + 4] > 0)
+                palette[i] = Average(&sums[i * 5], sums[i * 5 + 4]);
+    }
+}
+
+bool BuildPalette(const uint32_t* pixels, size_t count, size_t maxColors, vector<uint32_t>& palette)
+{
+    palette.clear();
+    if (FindExactColors(pixels, count, maxColors, false, palette))
+        return true;
+    
+    //Invisible pixels don't need their color preserved, which may be enough
+    palette.clear();
+    if (FindExactColors(pixels, count, maxColors, true, palette))
+        return false;
+    
+    //Sample the visible pixels, reserving an entry for fully transparent ones
+    vector<uint32_t> samples;
+    size_t stride = max(static_cast<size_t>(1), count / MAX_SAMPLES);
+    bool transparent = false;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if ((pixels[i] >> 24) == 0)
+            transparent = true;
+        else if (i % stride == 0)
+            samples.push_back(pixels[i]);
+    }
+    palette.clear();
+    if (transparent)
+        palette.push_back(0);
+    size_t first = palette.size();
+    if (!samples.empty())
+        MedianCut(samples, maxColors - first, palette);
+    RefineKMeans(samples, palette, first);
+    return false;
+}
+
+void MapToPalette(const uint32_t* pixels, size_t count, const vector<uint32_t>& palette, vector<unsigned char>& indices)
+{
+    indices.resize(count);
+    
+    //Find the fully transparent entry, if there is one
+    size_t clear = palette.size();
+    for (size_t i = 0; i < palette.size() && clear == palette.size(); ++i)
+        if ((palette[i] >> 24) == 0)
+            clear = i;
+    
+    //Each task maps a run of pixels, remembering recent colors since
+    //atlases tend to repeat the same few colors in long spans
+    int chunks = static_cast<int>((count + MAP_CHUNK - 1) / MAP_CHUNK);
+    ParallelFor(chunks, [&](int chunk) {
+        vector<uint32_t> keys(CACHE_SIZE, 0);
+        vector<int> values(CACHE_SIZE, -1);
+        size_t end = min(count, size_t(chunk + 1) * MAP_CHUNK);
+        for (size_t i = size_t(chunk) * MAP_CHUNK; i < end; ++i)
+        {
+            uint32_t color = pixels[i];
+            size_t slot = (color * 2654435761u) >> 20;
+            if (values[slot] < 0 || keys[slot] != color)
+            {
+                keys[slot] = color;
+                values[slot] = static_cast<int>(Nearest(color, palette));
+                
+                //Invisible pixels must stay invisible if their color was dropped
+                if ((color >> 24) == 0 && palette[values[slot]] != color && clear < palette.size())
+                    values[slot] = static_cast<int>(clear);
+            }
+            indices[i] = static_cast<unsigned char>(values[slot]);
+        }
+    });
+}
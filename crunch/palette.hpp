@@ -0,0 +1,45 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+#ifndef palette_hpp
+#define palette_hpp
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+//Builds a palette of at most maxColors RGBA colors for the pixels. If they
+//already use few enough colors the palette is exact and true is returned,
+//otherwise it is quantized with median cut and refined with k-means on a
+//sample of the pixels.
+bool BuildPalette(const uint32_t* pixels, size_t count, size_t maxColors, vector<uint32_t>& palette);
+
+//Maps every pixel to the index of its nearest palette color
+void MapToPalette(const uint32_t* pixels, size_t count, const vector<uint32_t>& palette, vector<unsigned char>& indices);
+
+#endif
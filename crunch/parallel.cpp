@@ -0,0 +1,131 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+#include "parallel.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <algorithm>
+
+//One ParallelFor call, which lives on the stack of the thread that made it
+struct Job
+{
+    const function<void(int)>* body;
+    int count;
+    int next;
+    int done;
+};
+
+//Threads that live for the whole process and take indices from the queued jobs. Every
+//job field is only touched under the lock, so a job can't be freed while a worker is
+//still looking at it.
+struct Pool
+{
+    mutex lock;
+    condition_variable queued;
+    condition_variable finished;
+    deque<Job*> jobs;
+    vector<thread> workers;
+    bool stopping;
+    
+    Pool()
+    : stopping(false)
+    {
+        int count = max(static_cast<int>(thread::hardware_concurrency()), 1) - 1;
+        for (int i = 0; i < count; ++i)
+            workers.emplace_back([this]() { Work(); });
+    }
+    
+    ~Pool()
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        queued.notify_all();
+        for (thread& worker : workers)
+            worker.join();
+    }
+    
+    //Takes the next index of a job, and drops the job from the queue once all of them are taken
+    int Claim(Job* job)
+    {
+        int i = job->next++;
+        if (job->next >= job->count)
+            jobs.erase(find(jobs.begin(), jobs.end(), job));
+        return i;
+    }
+    
+    void Run(Job* job, int i, unique_lock<mutex>& guard)
+    {
+        guard.unlock();
+        (*job->body)(i);
+        guard.lock();
+        if (++job->done == job->count)
+            finished.notify_all();
+    }
+    
+    void Work()
+    {
+        unique_lock<mutex> guard(lock);
+        while (true)
+        {
+            queued.wait(guard, [this]() { return stopping || !jobs.empty(); });
+            if (stopping)
+                return;
+            Job* job = jobs.front();
+            Run(job, Claim(job), guard);
+        }
+    }
+};
+
+void ParallelFor(int count, const function<void(int)>& body)
+{
+    static Pool pool;
+    if (count <= 0)
+        return;
+    if (count == 1 || pool.workers.empty())
+    {
+        for (int i = 0; i < count; ++i)
+            body(i);
+        return;
+    }
+    
+    //Calls made from inside a body go to the front, so idle workers help finish the
+    //innermost work first, which is what the outer bodies are waiting on
+    Job job = { &body, count, 0, 0 };
+    unique_lock<mutex> guard(pool.lock);
+    pool.jobs.push_front(&job);
+    pool.queued.notify_all();
+    
+    //The calling thread only ever runs its own job, since it may hold thread_local state
+    //that a body from another job would overwrite
+    while (job.next < job.count)
+        pool.Run(&job, pool.Claim(&job), guard);
+    pool.finished.wait(guard, [&]() { return job.done == job.count; });
+}
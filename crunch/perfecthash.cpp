@@ -0,0 +1,100 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+#include "perfecthash.hpp"
+#include "crunch_atlas.hpp"
+#include <algorithm>
+
+#define MAX_SEED (1 << 20)
+
+static bool TryBuild(const vector<uint64_t>& hashes, uint32_t bucketCount, vector<int32_t>& displacements, vector<uint32_t>& order)
+{
+    uint32_t count = static_cast<uint32_t>(hashes.size());
+    vector<vector<uint32_t>> buckets(bucketCount);
+    for (uint32_t i = 0; i < count; ++i)
+        buckets[crunch::GetAtlasNameBucket(hashes[i], bucketCount)].push_back(i);
+    
+    //Place the biggest buckets first, while most slots are still free
+    vector<uint32_t> sorted(bucketCount);
+    for (uint32_t i = 0; i < bucketCount; ++i)
+        sorted[i] = i;
+    stable_sort(sorted.begin(), sorted.end(), [&](uint32_t a, uint32_t b) {
+        return buckets[a].size() > buckets[b].size();
+    });
+    
+    displacements.assign(bucketCount, 0);
+    order.assign(count, UINT32_MAX);
+    vector<uint32_t> slots;
+    size_t next = 0;
+    for (; next < sorted.size() && buckets[sorted[next]].size() > 1; ++next)
+    {
+        const vector<uint32_t>& bucket = buckets[sorted[next]];
+        uint32_t seed = 1;
+        for (; seed < MAX_SEED; ++seed)
+        {
+            slots.clear();
+            for (uint32_t key : bucket)
+            {
+                uint32_t slot = crunch::GetAtlasNameSlot(hashes[key], seed, count);
+                if (order[slot] != UINT32_MAX || find(slots.begin(), slots.end(), slot) != slots.end())
+                    break;
+                slots.push_back(slot);
+            }
+            if (slots.size() == bucket.size())
+                break;
+        }
+        if (seed == MAX_SEED)
+            return false;
+        
+        displacements[sorted[next]] = static_cast<int32_t>(seed);
+        for (size_t i = 0; i < bucket.size(); ++i)
+            order[slots[i]] = bucket[i];
+    }
+    
+    //Single key buckets point straight at whatever slots are left
+    uint32_t free = 0;
+    for (; next < sorted.size() && buckets[sorted[next]].size() == 1; ++next)
+    {
+        while (order[free] != UINT32_MAX)
+            ++free;
+        displacements[sorted[next]] = -static_cast<int32_t>(free) - 1;
+        order[free] = buckets[sorted[next]][0];
+    }
+    return true;
+}
+
+bool BuildPerfectHash(const vector<uint64_t>& hashes, vector<int32_t>& displacements, vector<uint32_t>& order)
+{
+    //About four keys per bucket keeps the table small, fall back to
+    //more buckets if a seed can't be found
+    uint32_t count = static_cast<uint32_t>(hashes.size());
+    for (uint32_t keysPerBucket = 4; keysPerBucket > 0; keysPerBucket /= 2)
+        if (TryBuild(hashes, max(1u, count / keysPerBucket), displacements, order))
+            return true;
+    displacements.clear();
+    order.clear();
+    return false;
+}
@@ -0,0 +1,42 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+#ifndef perfecthash_hpp
+#define perfecthash_hpp
+
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+//Builds a minimal perfect hash over distinct name hashes with hash and
+//displace: each bucket gets a seed that moves all its keys to free slots,
+//or for single key buckets, -(slot + 1). Buckets and slots come from
+//crunch_atlas.hpp so readers always agree. On return order[slot] is the
+//index of the key in that slot. Returns false if no seeds could be found.
+bool BuildPerfectHash(const vector<uint64_t>& hashes, vector<int32_t>& displacements, vector<uint32_t>& order);
+
+#endif
@@ -0,0 +1,254 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+#include "qoi.hpp"
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF 0x40
+#define QOI_OP_LUMA 0x80
+#define QOI_OP_RUN 0xc0
+#define QOI_OP_RGB 0xfe
+#define QOI_OP_RGBA 0xff
+#define QOI_MASK_2 0xc0
+#define QOI_HEADER_SIZE 14
+#define QOI_PADDING_SIZE 8
+
+static const unsigned char qoiPadding[QOI_PADDING_SIZE] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+static inline int QoiHash(const unsigned char* px)
+{
+    return (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) & 63;
+}
+
+static inline uint32_t ReadBE32(const unsigned char* p)
+{
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+static inline unsigned char* WriteBE32(unsigned char* p, uint32_t v)
+{
+    *p++ = static_cast<unsigned char>(v >> 24);
+    *p++ = static_cast<unsigned char>(v >> 16);
+    *p++ = static_cast<unsigned char>(v >> 8);
+    *p++ = static_cast<unsigned char>(v);
+    return p;
+}
+
+bool QoiDecode(const unsigned char* data, size_t size, unsigned char** out, unsigned* w, unsigned* h)
+{
+    if (size < QOI_HEADER_SIZE + QOI_PADDING_SIZE || memcmp(data, "qoif", 4) != 0)
+        return false;
+    
+    uint32_t width = ReadBE32(data + 4);
+    uint32_t height = ReadBE32(data + 8);
+    unsigned char channels = data[12];
+    if (width == 0 || height == 0 || (channels != 3 && channels != 4) || height >= 400000000u / width)
+        return false;
+    
+    size_t count = size_t(width) * height;
+    unsigned char* pixels = reinterpret_cast<unsigned char*>(malloc(count * 4));
+    if (pixels == nullptr)
+        return false;
+    
+    unsigned char index[64 * 4];
+    memset(index, 0, sizeof(index));
+    unsigned char px[4] = { 0, 0, 0, 255 };
+    
+    const unsigned char* p = data + QOI_HEADER_SIZE;
+    const unsigned char* end = data + size - QOI_PADDING_SIZE;
+    int run = 0;
+    size_t i = 0;
+    for (; i < count; ++i)
+    {
+        if (run > 0)
+            --run;
+        else if (p < end)
+        {
+            int b1 = *p++;
+            if (b1 == QOI_OP_RGB)
+            {
+                if (end - p < 3)
+                    break;
+                px[0] = p[0];
+                px[1] = p[1];
+                px[2] = p[2];
+                p += 3;
+            }
+            else if (b1 == QOI_OP_RGBA)
+            {
+                if (end - p < 4)
+                    break;
+                memcpy(px, p, 4);
+                p += 4;
+            }
+            else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX)
+                memcpy(px, index + b1 * 4, 4);
+            else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF)
+            {
+                px[0] += ((b1 >> 4) & 3) - 2;
+                px[1] += ((b1 >> 2) & 3) - 2;
+                px[2] += (b1 & 3) - 2;
+            }
+            else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA)
+            {
+                if (p >= end)
+                    break;
+                int b2 = *p++;
+                int vg = (b1 & 0x3f) - 32;
+                px[0] += vg - 8 + ((b2 >> 4) & 0x0f);
+                px[1] += vg;
+                px[2] += vg - 8 + (b2 & 0x0f);
+            }
+            else
+                run = b1 & 0x3f;
+            
+            memcpy(index + QoiHash(px) * 4, px, 4);
+        }
+        else
+            break;
+        memcpy(pixels + i * 4, px, 4);
+    }
+    
+    //The stream ended early, so the rest of the pixels were never written
+    if (i < count)
+    {
+        free(pixels);
+        return false;
+    }
+    
+    *out = pixels;
+    *w = width;
+    *h = height;
+    return true;
+}
+
+void QoiEncode(vector<unsigned char>& out, const unsigned char* pixels, unsigned w, unsigned h)
+{
+    //Worst case is a full QOI_OP_RGBA for every pixel
+    size_t count = size_t(w) * h;
+    out.resize(QOI_HEADER_SIZE + count * 5 + QOI_PADDING_SIZE);
+    
+    unsigned char* p = out.data();
+    memcpy(p, "qoif", 4);
+    p = WriteBE32(p + 4, w);
+    p = WriteBE32(p, h);
+    *p++ = 4;
+    *p++ = 0;
+    
+    unsigned char index[64 * 4];
+    memset(index, 0, sizeof(index));
+    unsigned char prev[4] = { 0, 0, 0, 255 };
+    
+    int run = 0;
+    size_t i = 0;
+    for (; i < count; ++i)
+    {
+        const unsigned char* px = pixels + i * 4;
+        if (memcmp(px, prev, 4) == 0)
+        {
+            if (++run == 62 || i == count - 1)
+            {
+                *p++ = static_cast<unsigned char>(QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+            continue;
+        }
+        
+        if (run > 0)
+        {
+            *p++ = static_cast<unsigned char>(QOI_OP_RUN | (run - 1));
+            run = 0;
+        }
+        
+        int hash = QoiHash(px);
+        if (memcmp(index + hash * 4, px, 4) == 0)
+            *p++ = static_cast<unsigned char>(QOI_OP_INDEX | hash);
+        else
+        {
+            memcpy(index + hash * 4, px, 4);
+            if (px[3] == prev[3])
+            {
+                signed char vr = static_cast<signed char>(px[0] - prev[0]);
+                signed char vg = static_cast<signed char>(px[1] - prev[1]);
+                signed char vb = static_cast<signed char>(px[2] - prev[2]);
+                signed char vgr = static_cast<signed char>(vr - vg);
+                signed char vgb = static_cast<signed char>(vb - vg);
+                if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2)
+                    *p++ = static_cast<unsigned char>(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+                else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8)
+                {
+                    *p++ = static_cast<unsigned char>(QOI_OP_LUMA | (vg + 32));
+                    *p++ = static_cast<unsigned char>((vgr + 8) << 4 | (vgb + 8));
+                }
+                else
+                {
+                    *p++ = QOI_OP_RGB;
+                    *p++ = px[0];
+                    *p++ = px[1];
+                    *p++ = px[2];
+                }
+            }
+            else
+            {
+                *p++ = QOI_OP_RGBA;
+                memcpy(p, px, 4);
+                p += 4;
+            }
+        }
+        memcpy(prev, px, 4);
+    }
+    
+    memcpy(p, qoiPadding, QOI_PADDING_SIZE);
+    p += QOI_PADDING_SIZE;
+    out.resize(p - out.data());
+}
+
+bool LoadQoi(const string& file, unsigned char** out, unsigned* w, unsigned* h)
+{
+    ifstream stream(file, ios::binary | ios::ate);
+    if (!stream)
+        return false;
+    streamsize size = stream.tellg();
+    stream.seekg(0, ios::beg);
+    vector<unsigned char> buffer(static_cast<size_t>(size));
+    if (!stream.read(reinterpret_cast<char*>(buffer.data()), size))
+        return false;
+    return QoiDecode(buffer.data(), buffer.size(), out, w, h);
+}
+
+bool SaveQoi(const string& file, const unsigned char* pixels, unsigned w, unsigned h)
+{
+    vector<unsigned char> buffer;
+    QoiEncode(buffer, pixels, w, h);
+    ofstream stream(file, ios::binary);
+    stream.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    stream.close();
+    return !stream.fail();
+}
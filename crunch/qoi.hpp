@@ -0,0 +1,43 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+#ifndef qoi_hpp
+#define qoi_hpp
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//Decode/encode "Quite OK Image" files (https://qoiformat.org), a lossless
+//RGBA format that is much faster to read and write than png. Pixels are
+//always RGBA with 8 bits per channel, the same layout lodepng produces.
+bool QoiDecode(const unsigned char* data, size_t size, unsigned char** out, unsigned* w, unsigned* h);
+void QoiEncode(vector<unsigned char>& out, const unsigned char* pixels, unsigned w, unsigned h);
+bool LoadQoi(const string& file, unsigned char** out, unsigned* w, unsigned* h);
+bool SaveQoi(const string& file, const unsigned char* pixels, unsigned w, unsigned h);
+
+#endif
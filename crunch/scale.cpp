@@ -0,0 +1,160 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+
+#include "scale.hpp"
+#include "parallel.hpp"
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace std;
+
+#define LANCZOS_LOBES 3
+
+//The source pixels and weights that make up one output pixel along one axis
+struct Taps
+{
+    int first;
+    vector<float> weights;
+};
+
+static float Lanczos(float x)
+{
+    if (x == 0.0f)
+        return 1.0f;
+    if (fabs(x) >= LANCZOS_LOBES)
+        return 0.0f;
+    const float pi = 3.14159265358979f;
+    float px = pi * x;
+    return LANCZOS_LOBES * sin(px) * sin(px / LANCZOS_LOBES) / (px * px);
+}
+
+//Box taps cover the block of pixels each output pixel replaces, and lanczos taps reach
+//a few blocks further; taps past the edge repeat the edge pixel
+static void GetTaps(int size, int divisor, ScaleFilter filter, vector<Taps>& taps)
+{
+    int count = (size + divisor - 1) / divisor;
+    taps.resize(count);
+    for (int i = 0; i < count; ++i)
+    {
+        Taps& tap = taps[i];
+        tap.weights.clear();
+        if (filter == SCALE_BOX)
+        {
+            tap.first = i * divisor;
+            tap.weights.assign(min(divisor, size - tap.first), 1.0f);
+        }
+        else
+        {
+            float center = (i + 0.5f) * divisor;
+            int radius = LANCZOS_LOBES * divisor;
+            tap.first = static_cast<int>(floor(center)) - radius;
+            for (int j = tap.first; j < tap.first + 2 * radius; ++j)
+                tap.weights.push_back(Lanczos((j + 0.5f - center) / divisor));
+        }
+        
+        float total = 0.0f;
+        for (float weight : tap.weights)
+            total += weight;
+        for (float& weight : tap.weights)
+            weight /= total;
+    }
+}
+
+uint32_t* DownsamplePixels(const uint32_t* pixels, int width, int height, int divisor, ScaleFilter filter, bool premultiplied, int* outWidth, int* outHeight)
+{
+    vector<Taps> tapsX, tapsY;
+    GetTaps(width, divisor, filter, tapsX);
+    GetTaps(height, divisor, filter, tapsY);
+    int w = static_cast<int>(tapsX.size());
+    int h = static_cast<int>(tapsY.size());
+    
+    //Filter premultiplied colors, so each pixel counts as much as it is opaque
+    vector<float> src(size_t(width) * height * 4);
+    ParallelFor(height, [&](int y) {
+        for (size_t i = size_t(y) * width, n = i + width; i < n; ++i)
+        {
+            uint32_t c = pixels[i];
+            float a = static_cast<float>(c >> 24);
+            float m = premultiplied ? 1.0f : a / 255.0f;
+            src[i * 4 + 0] = (c & 0xff) * m;
+            src[i * 4 + 1] = ((c >> 8) & 0xff) * m;
+            src[i * 4 + 2] = ((c >> 16) & 0xff) * m;
+            src[i * 4 + 3] = a;
+        }
+    });
+    
+    //Rows first, then columns, each task filtering one row
+    vector<float> rows(size_t(w) * height * 4, 0.0f);
+    ParallelFor(height, [&](int y) {
+        const float* in = src.data() + size_t(y) * width * 4;
+        float* out = rows.data() + size_t(y) * w * 4;
+        for (int x = 0; x < w; ++x)
+        {
+            const Taps& tap = tapsX[x];
+            float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            for (size_t k = 0; k < tap.weights.size(); ++k)
+            {
+                const float* p = in + size_t(min(max(tap.first + static_cast<int>(k), 0), width - 1)) * 4;
+                for (int c = 0; c < 4; ++c)
+                    sum[c] += p[c] * tap.weights[k];
+            }
+            for (int c = 0; c < 4; ++c)
+                out[x * 4 + c] = sum[c];
+        }
+    });
+    
+    uint32_t* result = static_cast<uint32_t*>(malloc(sizeof(uint32_t) * size_t(w) * h));
+    ParallelFor(h, [&](int y) {
+        const Taps& tap = tapsY[y];
+        vector<float> sum(size_t(w) * 4, 0.0f);
+        for (size_t k = 0; k < tap.weights.size(); ++k)
+        {
+            const float* in = rows.data() + size_t(min(max(tap.first + static_cast<int>(k), 0), height - 1)) * w * 4;
+            float weight = tap.weights[k];
+            for (size_t i = 0; i < sum.size(); ++i)
+                sum[i] += in[i] * weight;
+        }
+        
+        //Lanczos overshoots, so colors are clamped to the alpha they were multiplied by
+        for (int x = 0; x < w; ++x)
+        {
+            float a = min(max(sum[x * 4 + 3], 0.0f), 255.0f);
+            float m = premultiplied ? 1.0f : (a > 0.0f ? 255.0f / a : 0.0f);
+            uint32_t rgba[4];
+            for (int c = 0; c < 3; ++c)
+                rgba[c] = static_cast<uint32_t>(min(max(sum[x * 4 + c], 0.0f), a) * m + 0.5f);
+            rgba[3] = static_cast<uint32_t>(a + 0.5f);
+            result[size_t(y) * w + x] = (rgba[3] << 24) | (min(rgba[2], 255u) << 16) | (min(rgba[1], 255u) << 8) | min(rgba[0], 255u);
+        }
+    });
+    
+    *outWidth = w;
+    *outHeight = h;
+    return result;
+}
@@ -0,0 +1,46 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+
+#ifndef scale_hpp
+#define scale_hpp
+
+#include <cstdint>
+
+using namespace std;
+
+enum ScaleFilter
+{
+    SCALE_BOX,
+    SCALE_LANCZOS
+};
+
+//Shrinks RGBA pixels by a whole factor into ceil(width / divisor) x ceil(height / divisor)
+//pixels allocated with malloc. Colors are always filtered weighted by their alpha, so
+//transparent pixels never darken the edges; premultiplied says which kind the pixels are.
+uint32_t* DownsamplePixels(const uint32_t* pixels, int width, int height, int divisor, ScaleFilter filter, bool premultiplied, int* outWidth, int* outHeight);
+
+#endif
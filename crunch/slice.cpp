@@ -0,0 +1,341 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+
+#include "slice.hpp"
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+
+//Just enough of a json reader for the sidecar files
+struct JsonValue
+{
+    enum Type
+    {
+        JSON_NULL,
+        JSON_BOOL,
+        JSON_NUMBER,
+        JSON_STRING,
+        JSON_ARRAY,
+        JSON_OBJECT
+    };
+    
+    Type type;
+    double number;
+    string text;
+    vector<JsonValue> items;
+    vector<pair<string, JsonValue>> members;
+    
+    JsonValue() : type(JSON_NULL), number(0) {}
+    
+    const JsonValue* Get(const string& key) const
+    {
+        for (const auto& member : members)
+            if (member.first == key)
+                return &member.second;
+        return nullptr;
+    }
+};
+
+static void SkipSpace(const char*& p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+        ++p;
+}
+
+static bool ParseJsonString(const char*& p, const char* end, string& str)
+{
+    if (p >= end || *p != '"')
+        return false;
+    for (++p; p < end && *p != '"'; ++p)
+    {
+        if (*p != '\\')
+        {
+            str += *p;
+            continue;
+        }
+        if (++p >= end)
+            return false;
+        switch (*p)
+        {
+            case 'n': str += '\n'; break;
+            case 't': str += '\t'; break;
+            case 'r': str += '\r'; break;
+            case 'b': str += '\b'; break;
+            case 'f': str += '\f'; break;
+            case 'u':
+            {
+                //Names are expected to be ascii, anything else becomes utf-8 without surrogate pairs
+                if (end - p < 5)
+                    return false;
+                unsigned long c = strtoul(string(p + 1, p + 5).c_str(), nullptr, 16);
+                if (c < 0x80)
+                    str += static_cast<char>(c);
+                else if (c < 0x800)
+                {
+                    str += static_cast<char>(0xc0 | (c >> 6));
+                    str += static_cast<char>(0x80 | (c & 0x3f));
+                }
+                else
+                {
+                    str += static_cast<char>(0xe0 | (c >> 12));
+                    str += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+                    str += static_cast<char>(0x80 | (c & 0x3f));
+                }
+                p += 4;
+                break;
+            }
+            default: str += *p; break;
+        }
+    }
+    if (p >= end)
+        return false;
+    ++p;
+    return true;
+}
+
+static bool ParseJson(const char*& p, const char* end, JsonValue& value, int depth)
+{
+    SkipSpace(p, end);
+    if (p >= end || depth > 64)
+        return false;
+    
+    if (*p == '{')
+    {
+        value.type = JsonValue::JSON_OBJECT;
+        SkipSpace(++p, end);
+        if (p < end && *p == '}')
+        {
+            ++p;
+            return true;
+        }
+        while (true)
+        {
+            string key;
+            SkipSpace(p, end);
+            if (!ParseJsonString(p, end, key))
+                return false;
+            SkipSpace(p, end);
+            if (p >= end || *p++ != ':')
+                return false;
+            value.members.push_back(make_pair(key, JsonValue()));
+            if (!ParseJson(p, end, value.members.back().second, depth + 1))
+                return false;
+            SkipSpace(p, end);
+            if (p < end && *p == ',')
+                ++p;
+            else if (p < end && *p == '}')
+            {
+                ++p;
+                return true;
+            }
+            else
+                return false;
+        }
+    }
+    if (*p == '[')
+    {
+        value.type = JsonValue::JSON_ARRAY;
+        SkipSpace(++p, end);
+        if (p < end && *p == ']')
+        {
+            ++p;
+            return true;
+        }
+        while (true)
+        {
+            value.items.push_back(JsonValue());
+            if (!ParseJson(p, end, value.items.back(), depth + 1))
+                return false;
+            SkipSpace(p, end);
+            if (p < end && *p == ',')
+                ++p;
+            else if (p < end && *p == ']')
+            {
+                ++p;
+                return true;
+            }
+            else
+                return false;
+        }
+    }
+    if (*p == '"')
+    {
+        value.type = JsonValue::JSON_STRING;
+        return ParseJsonString(p, end, value.text);
+    }
+    
+    //Numbers and literals run until the next delimiter
+    const char* start = p;
+    while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r')
+        ++p;
+    string token(start, p);
+    if (token == "true" || token == "false")
+    {
+        value.type = JsonValue::JSON_BOOL;
+        value.number = token == "true" ? 1 : 0;
+        return true;
+    }
+    if (token == "null")
+        return true;
+    char* last;
+    value.type = JsonValue::JSON_NUMBER;
+    value.number = strtod(token.c_str(), &last);
+    return !token.empty() && *last == '\0';
+}
+
+static bool GetInt(const JsonValue& object, const char* key, int& value, bool required)
+{
+    const JsonValue* member = object.Get(key);
+    if (member == nullptr)
+        return !required;
+    if (member->type != JsonValue::JSON_NUMBER || member->number < 0 || member->number > 1 << 20)
+        return false;
+    value = static_cast<int>(member->number);
+    return true;
+}
+
+string GetSliceFile(const string& image)
+{
+    size_t dot = image.rfind('.');
+    size_t slash = image.find_last_of("/\\");
+    if (dot == string::npos || (slash != string::npos && dot < slash))
+        dot = image.size();
+    return image.substr(0, dot) + ".slices.json";
+}
+
+bool IsSliceFile(const string& file)
+{
+    static const string ext = ".slices.json";
+    return file.size() >= ext.size() && file.compare(file.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+bool LoadSlices(const string& file, SliceGrid& grid, vector<Slice>& slices)
+{
+    ifstream stream(file, ios::binary);
+    if (!stream)
+        return false;
+    stringstream buffer;
+    buffer << stream.rdbuf();
+    string text = buffer.str();
+    
+    JsonValue root;
+    const char* p = text.data();
+    const char* end = p + text.size();
+    if (!ParseJson(p, end, root, 0) || root.type != JsonValue::JSON_OBJECT)
+        return false;
+    
+    grid = { 0, 0, 0, 0 };
+    slices.clear();
+    const JsonValue* gridValue = root.Get("Grid");
+    if (gridValue != nullptr)
+    {
+        if (gridValue->type != JsonValue::JSON_OBJECT)
+            return false;
+        return GetInt(*gridValue, "W", grid.width, true) && GetInt(*gridValue, "H", grid.height, true) &&
+            GetInt(*gridValue, "Margin", grid.margin, false) && GetInt(*gridValue, "Spacing", grid.spacing, false) &&
+            grid.width > 0 && grid.height > 0;
+    }
+    
+    const JsonValue* images = root.Get("Images");
+    if (images == nullptr || images->type != JsonValue::JSON_ARRAY)
+        return false;
+    for (const JsonValue& image : images->items)
+    {
+        Slice slice;
+        const JsonValue* name = image.Get("Name");
+        if (image.type != JsonValue::JSON_OBJECT || name == nullptr || name->type != JsonValue::JSON_STRING || name->text.empty())
+            return false;
+        if (!GetInt(image, "X", slice.x, true) || !GetInt(image, "Y", slice.y, true) ||
+            !GetInt(image, "W", slice.width, true) || !GetInt(image, "H", slice.height, true) ||
+            slice.width <= 0 || slice.height <= 0)
+            return false;
+        
+        //Names can keep the extension they had as separate files, like crunch's own json has them
+        slice.name = name->text;
+        size_t dot = slice.name.rfind('.');
+        if (dot != string::npos && (slice.name.compare(dot, string::npos, ".png") == 0 || slice.name.compare(dot, string::npos, ".qoi") == 0))
+            slice.name.erase(dot);
+        slices.push_back(slice);
+    }
+    return true;
+}
+
+bool ParseSliceGrid(const string& str, SliceGrid& grid)
+{
+    grid = { 0, 0, 0, 0 };
+    char x, comma1, comma2;
+    istringstream ss(str);
+    if (!(ss >> grid.width >> x >> grid.height) || x != 'x' || grid.width <= 0 || grid.height <= 0)
+        return false;
+    if (ss >> comma1 && (comma1 != ',' || !(ss >> grid.margin) || grid.margin < 0))
+        return false;
+    if (ss >> comma2 && (comma2 != ',' || !(ss >> grid.spacing) || grid.spacing < 0))
+        return false;
+    return ss.eof();
+}
+
+void GetGridSlices(const SliceGrid& grid, int width, int height, vector<Slice>& slices)
+{
+    slices.clear();
+    int index = 0;
+    for (int y = grid.margin; y + grid.height <= height; y += grid.height + grid.spacing)
+        for (int x = grid.margin; x + grid.width <= width; x += grid.width + grid.spacing)
+            slices.push_back({ to_string(index++), x, y, grid.width, grid.height });
+}
+
+bool IsSliceInside(const Slice& slice, int width, int height)
+{
+    return slice.x >= 0 && slice.y >= 0 && slice.x + slice.width <= width && slice.y + slice.height <= height;
+}
+
+uint32_t* CopySlice(const uint32_t* pixels, int width, const Slice& slice, bool skipEmpty)
+{
+    if (skipEmpty)
+    {
+        bool empty = true;
+        for (int y = 0; y < slice.height && empty; ++y)
+        {
+            const uint32_t* row = pixels + size_t(slice.y + y) * width + slice.x;
+            for (int x = 0; x < slice.width; ++x)
+            {
+                if ((row[x] >> 24) > 0)
+                {
+                    empty = false;
+                    break;
+                }
+            }
+        }
+        if (empty)
+            return nullptr;
+    }
+    
+    uint32_t* copy = static_cast<uint32_t*>(malloc(sizeof(uint32_t) * size_t(slice.width) * slice.height));
+    for (int y = 0; y < slice.height; ++y)
+        memcpy(copy + size_t(y) * slice.width, pixels + size_t(slice.y + y) * width + slice.x, sizeof(uint32_t) * slice.width);
+    return copy;
+}
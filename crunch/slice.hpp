@@ -0,0 +1,79 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+
+#ifndef slice_hpp
+#define slice_hpp
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+//Cells of the same size laid out in rows, margin is the offset of the first cell from the
+//top left of the sheet and spacing the gap between cells
+struct SliceGrid
+{
+    int width;
+    int height;
+    int margin;
+    int spacing;
+};
+
+//A sprite cut out of a sheet, named relative to the sheet
+struct Slice
+{
+    string name;
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+//The sidecar next to a sheet that describes how to slice it, hero.png has hero.slices.json
+string GetSliceFile(const string& image);
+bool IsSliceFile(const string& file);
+
+//Reads a sidecar, which holds either a grid or a list of rects:
+//  { "Grid": { "W": 32, "H": 32, "Margin": 0, "Spacing": 0 } }
+//  { "Images": [ { "Name": "idle0", "X": 0, "Y": 0, "W": 32, "H": 32 }, ... ] }
+bool LoadSlices(const string& file, SliceGrid& grid, vector<Slice>& slices);
+
+//Parses WxH[,MARGIN[,SPACING]]
+bool ParseSliceGrid(const string& str, SliceGrid& grid);
+
+//Lists the cells of a grid that fit on the sheet, named by their index in row order
+void GetGridSlices(const SliceGrid& grid, int width, int height, vector<Slice>& slices);
+
+//True if the slice lies completely on a sheet of the given size
+bool IsSliceInside(const Slice& slice, int width, int height);
+
+//Copies a slice out of a sheet width pixels wide into pixels allocated with malloc, which a Bitmap can take
+//over. Returns nullptr if the slice is completely transparent and skipEmpty is set.
+uint32_t* CopySlice(const uint32_t* pixels, int width, const Slice& slice, bool skipEmpty);
+
+#endif
@@ -207,3 +207,12 @@ void EnsureDirectoryExists(const string& path) {
         }
     #endif
 }
+
+bool RenameFile(const string& from, const string& to)
+{
+    #if defined _MSC_VER || defined __MINGW32__
+        return MoveFileExW(StrToPath(from).c_str(), StrToPath(to).c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+    #else
+        return rename(from.c_str(), to.c_str()) == 0;
+    #endif
+}
@@ -46,4 +46,7 @@ string NormalizePath(const string& path);
 // Ensures the specified directory path exists, creating it if necessary (including parent directories)
 void EnsureDirectoryExists(const string& path);
 
+// Moves a file to a new path, replacing any file already there in a single step
+bool RenameFile(const string& from, const string& to);
+
 #endif
@@ -0,0 +1,494 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+#include "texture.hpp"
+#include "binary.hpp"
+#include "lz4.hpp"
+#include "bcn.hpp"
+#include "etc.hpp"
+#include "parallel.hpp"
+#include "scale.hpp"
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+#define VK_FORMAT_R4G4B4A4_UNORM_PACK16 2
+#define VK_FORMAT_R5G6B5_UNORM_PACK16 4
+#define VK_FORMAT_R5G5B5A1_UNORM_PACK16 6
+#define VK_FORMAT_R8G8B8A8_UNORM 37
+#define VK_FORMAT_BC1_RGBA_UNORM_BLOCK 133
+#define VK_FORMAT_BC3_UNORM_BLOCK 137
+#define VK_FORMAT_BC7_UNORM_BLOCK 145
+#define VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK 151
+
+#define DXGI_FORMAT_BC7_UNORM 98
+#define DDS_ALPHA_MODE_STRAIGHT 1
+#define DDS_ALPHA_MODE_PREMULTIPLIED 2
+
+#define KHR_DF_MODEL_RGBSDA 1
+#define KHR_DF_MODEL_BC1A 128
+#define KHR_DF_MODEL_BC3 130
+#define KHR_DF_MODEL_BC7 134
+#define KHR_DF_MODEL_ETC2 161
+#define KHR_DF_PRIMARIES_BT709 1
+#define KHR_DF_TRANSFER_LINEAR 1
+#define KHR_DF_FLAG_ALPHA_PREMULTIPLIED 1
+#define KHR_DF_CHANNEL_RGBSDA_ALPHA 15
+#define KHR_DF_CHANNEL_BC1A_ALPHAPRESENT 1
+#define KHR_DF_CHANNEL_BC3_COLOR 0
+#define KHR_DF_CHANNEL_BC3_ALPHA 15
+#define KHR_DF_CHANNEL_BC7_COLOR 0
+#define KHR_DF_CHANNEL_ETC2_COLOR 2
+#define KHR_DF_CHANNEL_ETC2_ALPHA 15
+
+#define RAW_COMPRESSION_NONE 0
+#define RAW_COMPRESSION_LZ4 1
+
+static const unsigned char ktx2Identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+Texture::Texture(const Bitmap& bitmap, bool premultiplied)
+: format(TEXTURE_RGBA8), premultiplied(premultiplied)
+{
+    TextureLevel level;
+    level.width = bitmap.width;
+    level.height = bitmap.height;
+    const unsigned char* pixels = reinterpret_cast<const unsigned char*>(bitmap.data);
+    level.data.assign(pixels, pixels + size_t(bitmap.width) * bitmap.height * 4);
+    levels.push_back(level);
+}
+
+void Texture::GenerateMips(int count)
+{
+    if (format != TEXTURE_RGBA8 || count <= 0)
+        return;
+    
+    //Every level is box filtered straight from the full page, which matches halving it
+    //over and over without rounding to 8 bits in between; the filter weighs colors by
+    //alpha, so transparent gutters never darken the sprites next to them
+    levels.resize(levels.size() + count);
+    const TextureLevel& base = levels.front();
+    const uint32_t* pixels = reinterpret_cast<const uint32_t*>(base.data.data());
+    ParallelFor(count, [&](int i) {
+        TextureLevel& level = levels[i + 1];
+        uint32_t* mip = DownsamplePixels(pixels, base.width, base.height, 1 << (i + 1), SCALE_BOX, premultiplied, &level.width, &level.height);
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(mip);
+        level.data.assign(bytes, bytes + size_t(level.width) * level.height * 4);
+        free(mip);
+    });
+}
+
+void Texture::Compress(TextureFormat target, bool best)
+{
+    void (*encode)(const unsigned char*, unsigned char*) = nullptr;
+    switch (target)
+    {
+        case TEXTURE_BC1: encode = EncodeBc1; break;
+        case TEXTURE_BC3: encode = EncodeBc3; break;
+        case TEXTURE_BC7: encode = EncodeBc7; break;
+        case TEXTURE_ETC2: encode = best ? EncodeEtc2Best : EncodeEtc2Fast; break;
+        default: return;
+    }
+    
+    int blockBytes = GetBlockBytes(target);
+    for (TextureLevel& level : levels)
+    {
+        int bw = (level.width + 3) / 4;
+        int bh = (level.height + 3) / 4;
+        vector<unsigned char> blocks(size_t(bw) * bh * blockBytes);
+        const TextureLevel& src = level;
+        
+        //Each task encodes one row of blocks, clamping at the page edges
+        ParallelFor(bh, [&](int by) {
+            unsigned char block[64];
+            for (int bx = 0; bx < bw; ++bx)
+            {
+                for (int y = 0; y < 4; ++y)
+                {
+                    int sy = min(by * 4 + y, src.height - 1);
+                    for (int x = 0; x < 4; ++x)
+                    {
+                        int sx = min(bx * 4 + x, src.width - 1);
+                        memcpy(block + (y * 4 + x) * 4, src.data.data() + (size_t(sy) * src.width + sx) * 4, 4);
+                    }
+                }
+                encode(block, blocks.data() + (size_t(by) * bw + bx) * blockBytes);
+            }
+        });
+        
+        level.data.swap(blocks);
+    }
+    format = target;
+}
+
+void Texture::Convert(TextureFormat target, DitherMode dither)
+{
+    const PackedLayout* layout = nullptr;
+    switch (target)
+    {
+        case TEXTURE_RGBA4444: layout = &layoutRgba4444; break;
+        case TEXTURE_RGB565: layout = &layoutRgb565; break;
+        case TEXTURE_RGBA5551: layout = &layoutRgba5551; break;
+        default: return;
+    }
+    
+    for (TextureLevel& level : levels)
+    {
+        vector<unsigned char> packed;
+        PackPixels(level.data.data(), level.width, level.height, *layout, dither, packed);
+        level.data.swap(packed);
+    }
+    format = target;
+}
+
+uint32_t GetVkFormat(TextureFormat format)
+{
+    switch (format)
+    {
+        case TEXTURE_RGBA8: return VK_FORMAT_R8G8B8A8_UNORM;
+        case TEXTURE_BC1: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+        case TEXTURE_BC3: return VK_FORMAT_BC3_UNORM_BLOCK;
+        case TEXTURE_BC7: return VK_FORMAT_BC7_UNORM_BLOCK;
+        case TEXTURE_ETC2: return VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK;
+        case TEXTURE_RGBA4444: return VK_FORMAT_R4G4B4A4_UNORM_PACK16;
+        case TEXTURE_RGB565: return VK_FORMAT_R5G6B5_UNORM_PACK16;
+        case TEXTURE_RGBA5551: return VK_FORMAT_R5G5B5A1_UNORM_PACK16;
+    }
+    return 0;
+}
+
+int GetBlockBytes(TextureFormat format)
+{
+    switch (format)
+    {
+        case TEXTURE_RGBA8: return 4;
+        case TEXTURE_BC1: return 8;
+        case TEXTURE_BC3: return 16;
+        case TEXTURE_BC7: return 16;
+        case TEXTURE_ETC2: return 16;
+        case TEXTURE_RGBA4444: return 2;
+        case TEXTURE_RGB565: return 2;
+        case TEXTURE_RGBA5551: return 2;
+    }
+    return 0;
+}
+
+bool IsBlockCompressed(TextureFormat format)
+{
+    return format != TEXTURE_RGBA8 && !IsPacked16(format);
+}
+
+bool IsPacked16(TextureFormat format)
+{
+    return format == TEXTURE_RGBA4444 || format == TEXTURE_RGB565 || format == TEXTURE_RGBA5551;
+}
+
+//Bit masks of the red, green, blue and alpha channels within one pixel
+static void GetChannelMasks(TextureFormat format, uint32_t masks[4])
+{
+    const PackedLayout* layout = nullptr;
+    switch (format)
+    {
+        case TEXTURE_RGBA4444: layout = &layoutRgba4444; break;
+        case TEXTURE_RGB565: layout = &layoutRgb565; break;
+        case TEXTURE_RGBA5551: layout = &layoutRgba5551; break;
+        default:
+            masks[0] = 0x000000ff;
+            masks[1] = 0x0000ff00;
+            masks[2] = 0x00ff0000;
+            masks[3] = 0xff000000;
+            return;
+    }
+    for (int c = 0; c < 4; ++c)
+        masks[c] = ((1u << layout->bits[c]) - 1) << layout->shift[c];
+}
+
+static void PutSample(vector<unsigned char>& dfd, uint32_t bitOffset, uint32_t bitLength, uint32_t channel, uint32_t upper)
+{
+    PutU16(dfd, bitOffset);
+    PutU8(dfd, bitLength - 1);
+    PutU8(dfd, channel);
+    PutU32(dfd, 0); //sample position
+    PutU32(dfd, 0); //lower
+    PutU32(dfd, upper);
+}
+
+static uint32_t GetColorModel(TextureFormat format)
+{
+    switch (format)
+    {
+        case TEXTURE_RGBA8:
+        case TEXTURE_RGBA4444:
+        case TEXTURE_RGB565:
+        case TEXTURE_RGBA5551:
+            return KHR_DF_MODEL_RGBSDA;
+        case TEXTURE_BC1: return KHR_DF_MODEL_BC1A;
+        case TEXTURE_BC3: return KHR_DF_MODEL_BC3;
+        case TEXTURE_BC7: return KHR_DF_MODEL_BC7;
+        case TEXTURE_ETC2: return KHR_DF_MODEL_ETC2;
+    }
+    return 0;
+}
+
+//Writes the Khronos Data Format descriptor for the texture's format
+static void PutDfd(vector<unsigned char>& buf, const Texture& texture)
+{
+    vector<unsigned char> dfd;
+    PutU32(dfd, 0); //vendor id and descriptor type
+    PutU32(dfd, 0); //version and block size, patched below
+    PutU8(dfd, GetColorModel(texture.format));
+    PutU8(dfd, KHR_DF_PRIMARIES_BT709);
+    PutU8(dfd, KHR_DF_TRANSFER_LINEAR);
+    PutU8(dfd, texture.premultiplied ? KHR_DF_FLAG_ALPHA_PREMULTIPLIED : 0);
+    PutU32(dfd, IsBlockCompressed(texture.format) ? 0x0303 : 0); //texel block dimensions minus one
+    PutU32(dfd, GetBlockBytes(texture.format)); //bytes in plane 0
+    PutU32(dfd, 0);
+    switch (texture.format)
+    {
+        case TEXTURE_RGBA8:
+            PutSample(dfd, 0, 8, 0, 255);
+            PutSample(dfd, 8, 8, 1, 255);
+            PutSample(dfd, 16, 8, 2, 255);
+            PutSample(dfd, 24, 8, KHR_DF_CHANNEL_RGBSDA_ALPHA, 255);
+            break;
+        case TEXTURE_BC1:
+            PutSample(dfd, 0, 64, KHR_DF_CHANNEL_BC1A_ALPHAPRESENT, 0xffffffff);
+            break;
+        case TEXTURE_BC3:
+            PutSample(dfd, 0, 64, KHR_DF_CHANNEL_BC3_ALPHA, 0xffffffff);
+            PutSample(dfd, 64, 64, KHR_DF_CHANNEL_BC3_COLOR, 0xffffffff);
+            break;
+        case TEXTURE_BC7:
+            PutSample(dfd, 0, 128, KHR_DF_CHANNEL_BC7_COLOR, 0xffffffff);
+            break;
+        case TEXTURE_ETC2:
+            PutSample(dfd, 0, 64, KHR_DF_CHANNEL_ETC2_ALPHA, 0xffffffff);
+            PutSample(dfd, 64, 64, KHR_DF_CHANNEL_ETC2_COLOR, 0xffffffff);
+            break;
+        case TEXTURE_RGBA4444:
+        case TEXTURE_RGB565:
+        case TEXTURE_RGBA5551:
+        {
+            //Packed samples are listed from the least significant bit up
+            uint32_t masks[4];
+            GetChannelMasks(texture.format, masks);
+            for (int c = 4; c-- > 0;)
+            {
+                if (masks[c] == 0)
+                    continue;
+                uint32_t shift = 0;
+                while (!(masks[c] & (1u << shift)))
+                    ++shift;
+                uint32_t upper = masks[c] >> shift;
+                uint32_t length = 0;
+                while (upper >> length)
+                    ++length;
+                PutSample(dfd, shift, length, c == 3 ? KHR_DF_CHANNEL_RGBSDA_ALPHA : c, upper);
+            }
+            break;
+        }
+    }
+    SetU32(dfd, 4, 2 | (static_cast<uint32_t>(dfd.size()) << 16));
+    
+    PutU32(buf, static_cast<uint32_t>(dfd.size() + 4));
+    buf.insert(buf.end(), dfd.begin(), dfd.end());
+}
+
+bool EncodeKtx2(vector<unsigned char>& buf, const Texture& texture)
+{
+    const TextureLevel& base = texture.levels.front();
+    uint32_t levelCount = static_cast<uint32_t>(texture.levels.size());
+    
+    buf.clear();
+    buf.insert(buf.end(), ktx2Identifier, ktx2Identifier + sizeof(ktx2Identifier));
+    PutU32(buf, GetVkFormat(texture.format));
+    PutU32(buf, IsPacked16(texture.format) ? 2 : 1); //type size
+    PutU32(buf, base.width);
+    PutU32(buf, base.height);
+    PutU32(buf, 0); //depth
+    PutU32(buf, 0); //layers
+    PutU32(buf, 1); //faces
+    PutU32(buf, levelCount);
+    PutU32(buf, 0); //no supercompression
+    
+    //Index, patched once the sections are laid out
+    size_t indexPos = buf.size();
+    buf.resize(buf.size() + 32 + 24 * levelCount, 0);
+    
+    uint32_t dfdOffset = static_cast<uint32_t>(buf.size());
+    PutDfd(buf, texture);
+    uint32_t dfdLength = static_cast<uint32_t>(buf.size()) - dfdOffset;
+    
+    const char kvd[] = "KTXwriter\0crunch";
+    uint32_t kvdOffset = static_cast<uint32_t>(buf.size());
+    PutU32(buf, sizeof(kvd));
+    buf.insert(buf.end(), kvd, kvd + sizeof(kvd));
+    Align(buf, 4);
+    uint32_t kvdLength = static_cast<uint32_t>(buf.size()) - kvdOffset;
+    
+    SetU32(buf, indexPos, dfdOffset);
+    SetU32(buf, indexPos + 4, dfdLength);
+    SetU32(buf, indexPos + 8, kvdOffset);
+    SetU32(buf, indexPos + 12, kvdLength);
+    SetU64(buf, indexPos + 16, 0);
+    SetU64(buf, indexPos + 24, 0);
+    
+    //Mip levels are stored smallest first, aligned to lcm(block size, 4)
+    size_t alignment = max(GetBlockBytes(texture.format), 4);
+    for (size_t i = levelCount; i-- > 0;)
+    {
+        const TextureLevel& level = texture.levels[i];
+        Align(buf, alignment);
+        size_t entry = indexPos + 32 + 24 * i;
+        SetU64(buf, entry, buf.size());
+        SetU64(buf, entry + 8, level.data.size());
+        SetU64(buf, entry + 16, level.data.size());
+        buf.insert(buf.end(), level.data.begin(), level.data.end());
+    }
+    
+    return true;
+}
+
+bool SaveKtx2(const Texture& texture, const string& file)
+{
+    vector<unsigned char> buf;
+    return EncodeKtx2(buf, texture) && WriteFile(file, buf);
+}
+
+bool EncodeDds(vector<unsigned char>& buf, const Texture& texture)
+{
+    //DDS has no ETC2 format
+    if (texture.format == TEXTURE_ETC2)
+        return false;
+    
+    const TextureLevel& base = texture.levels.front();
+    uint32_t levelCount = static_cast<uint32_t>(texture.levels.size());
+    bool compressed = IsBlockCompressed(texture.format);
+    
+    buf.clear();
+    buf.insert(buf.end(), { 'D', 'D', 'S', ' ' });
+    PutU32(buf, 124);
+    uint32_t flags = 0x1 | 0x2 | 0x4 | 0x1000; //caps, height, width, pixel format
+    flags |= compressed ? 0x80000 : 0x8; //linear size or pitch
+    if (levelCount > 1)
+        flags |= 0x20000; //mip count
+    PutU32(buf, flags);
+    PutU32(buf, base.height);
+    PutU32(buf, base.width);
+    PutU32(buf, compressed ? static_cast<uint32_t>(base.data.size()) : base.width * GetBlockBytes(texture.format));
+    PutU32(buf, 0); //depth
+    PutU32(buf, levelCount);
+    for (int i = 0; i < 11; ++i)
+        PutU32(buf, 0);
+    
+    //Pixel format
+    PutU32(buf, 32);
+    if (compressed)
+    {
+        PutU32(buf, 0x4); //fourcc
+        const char* fourcc = texture.format == TEXTURE_BC1 ? "DXT1" : texture.format == TEXTURE_BC3 ? "DXT5" : "DX10";
+        buf.insert(buf.end(), fourcc, fourcc + 4);
+        for (int i = 0; i < 5; ++i)
+            PutU32(buf, 0);
+    }
+    else
+    {
+        uint32_t masks[4];
+        GetChannelMasks(texture.format, masks);
+        PutU32(buf, masks[3] != 0 ? 0x40 | 0x1 : 0x40); //rgb, with alpha if present
+        PutU32(buf, 0);
+        PutU32(buf, GetBlockBytes(texture.format) * 8);
+        for (int c = 0; c < 4; ++c)
+            PutU32(buf, masks[c]);
+    }
+    
+    uint32_t caps = 0x1000; //texture
+    if (levelCount > 1)
+        caps |= 0x8 | 0x400000; //complex, mipmap
+    PutU32(buf, caps);
+    for (int i = 0; i < 4; ++i)
+        PutU32(buf, 0);
+    
+    if (texture.format == TEXTURE_BC7)
+    {
+        PutU32(buf, DXGI_FORMAT_BC7_UNORM);
+        PutU32(buf, 3); //texture 2d
+        PutU32(buf, 0);
+        PutU32(buf, 1); //array size
+        PutU32(buf, texture.premultiplied ? DDS_ALPHA_MODE_PREMULTIPLIED : DDS_ALPHA_MODE_STRAIGHT);
+    }
+    
+    for (const TextureLevel& level : texture.levels)
+        buf.insert(buf.end(), level.data.begin(), level.data.end());
+    
+    return true;
+}
+
+bool SaveDds(const Texture& texture, const string& file)
+{
+    vector<unsigned char> buf;
+    return EncodeDds(buf, texture) && WriteFile(file, buf);
+}
+
+bool EncodeRaw(vector<unsigned char>& buf, const Texture& texture, bool lz4)
+{
+    const TextureLevel& base = texture.levels.front();
+    uint32_t levelCount = static_cast<uint32_t>(texture.levels.size());
+    
+    buf.clear();
+    buf.insert(buf.end(), { 'C', 'R', 'A', 'W' });
+    PutU32(buf, 1); //version
+    PutU32(buf, GetVkFormat(texture.format));
+    PutU32(buf, base.width);
+    PutU32(buf, base.height);
+    PutU32(buf, levelCount);
+    PutU32(buf, lz4 ? RAW_COMPRESSION_LZ4 : RAW_COMPRESSION_NONE);
+    PutU32(buf, texture.premultiplied ? 1 : 0);
+    
+    size_t indexPos = buf.size();
+    buf.resize(buf.size() + 24 * levelCount, 0);
+    
+    for (size_t i = 0; i < levelCount; ++i)
+    {
+        const TextureLevel& level = texture.levels[i];
+        Align(buf, 16);
+        size_t offset = buf.size();
+        if (lz4)
+            Lz4Compress(level.data.data(), level.data.size(), buf);
+        else
+            buf.insert(buf.end(), level.data.begin(), level.data.end());
+        SetU64(buf, indexPos + 24 * i, offset);
+        SetU64(buf, indexPos + 24 * i + 8, buf.size() - offset);
+        SetU64(buf, indexPos + 24 * i + 16, level.data.size());
+    }
+    
+    return true;
+}
+
+bool SaveRaw(const Texture& texture, const string& file, bool lz4)
+{
+    vector<unsigned char> buf;
+    return EncodeRaw(buf, texture, lz4) && WriteFile(file, buf);
+}
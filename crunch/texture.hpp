@@ -0,0 +1,85 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+#ifndef texture_hpp
+#define texture_hpp
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "bitmap.hpp"
+#include "dither.hpp"
+
+using namespace std;
+
+//GPU pixel formats an atlas page can be stored in
+enum TextureFormat
+{
+    TEXTURE_RGBA8,
+    TEXTURE_BC1,
+    TEXTURE_BC3,
+    TEXTURE_BC7,
+    TEXTURE_ETC2,
+    TEXTURE_RGBA4444,
+    TEXTURE_RGB565,
+    TEXTURE_RGBA5551
+};
+
+struct TextureLevel
+{
+    int width;
+    int height;
+    vector<unsigned char> data;
+};
+
+//A page converted to a GPU-ready layout, with rows tightly packed so it
+//can be handed straight to glTexImage2D or a Vulkan staging buffer
+struct Texture
+{
+    TextureFormat format;
+    bool premultiplied;
+    vector<TextureLevel> levels;
+    Texture(const Bitmap& bitmap, bool premultiplied);
+    
+    //Adds count mip levels below the full page, each one half the size of the last; call
+    //it before Compress or Convert
+    void GenerateMips(int count);
+    void Compress(TextureFormat format, bool best);
+    void Convert(TextureFormat format, DitherMode dither);
+};
+
+uint32_t GetVkFormat(TextureFormat format);
+int GetBlockBytes(TextureFormat format);
+bool IsBlockCompressed(TextureFormat format);
+bool IsPacked16(TextureFormat format);
+bool EncodeKtx2(vector<unsigned char>& buf, const Texture& texture);
+bool EncodeDds(vector<unsigned char>& buf, const Texture& texture);
+bool EncodeRaw(vector<unsigned char>& buf, const Texture& texture, bool lz4);
+bool SaveKtx2(const Texture& texture, const string& file);
+bool SaveDds(const Texture& texture, const string& file);
+bool SaveRaw(const Texture& texture, const string& file, bool lz4);
+
+#endif
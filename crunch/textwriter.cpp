@@ -0,0 +1,117 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+#include "textwriter.hpp"
+#include <cstring>
+#include <cstdint>
+
+static const char digitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+TextWriter::TextWriter(ostream& stream)
+: stream(stream), size(0)
+{
+}
+
+TextWriter::~TextWriter()
+{
+    Flush();
+}
+
+void TextWriter::Write(const char* data, size_t length)
+{
+    if (size + length > TEXT_WRITER_BUFFER_SIZE)
+    {
+        Flush();
+        if (length > TEXT_WRITER_BUFFER_SIZE)
+        {
+            stream.write(data, length);
+            return;
+        }
+    }
+    memcpy(buffer + size, data, length);
+    size += length;
+}
+
+void TextWriter::Flush()
+{
+    if (size > 0)
+        stream.write(buffer, size);
+    size = 0;
+}
+
+TextWriter& TextWriter::operator<<(const char* str)
+{
+    Write(str, strlen(str));
+    return *this;
+}
+
+TextWriter& TextWriter::operator<<(const string& str)
+{
+    Write(str.data(), str.size());
+    return *this;
+}
+
+TextWriter& TextWriter::operator<<(char c)
+{
+    Write(&c, 1);
+    return *this;
+}
+
+TextWriter& TextWriter::operator<<(int value)
+{
+    //Digits are written back to front, two at a time
+    char digits[12];
+    char* end = digits + sizeof(digits);
+    char* ptr = end;
+    uint32_t n = value < 0 ? 0u - static_cast<uint32_t>(value) : static_cast<uint32_t>(value);
+    while (n >= 100)
+    {
+        ptr -= 2;
+        memcpy(ptr, digitPairs + (n % 100) * 2, 2);
+        n /= 100;
+    }
+    if (n >= 10)
+    {
+        ptr -= 2;
+        memcpy(ptr, digitPairs + n * 2, 2);
+    }
+    else
+        *--ptr = static_cast<char>('0' + n);
+    if (value < 0)
+        *--ptr = '-';
+    Write(ptr, end - ptr);
+    return *this;
+}
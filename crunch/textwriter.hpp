@@ -0,0 +1,55 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+#ifndef textwriter_hpp
+#define textwriter_hpp
+
+#include <ostream>
+#include <string>
+
+using namespace std;
+
+#define TEXT_WRITER_BUFFER_SIZE 65536
+
+//Collects text in a fixed buffer and formats integers by hand, so big xml
+//and json documents go out in a few large writes instead of a flush per line
+struct TextWriter
+{
+    ostream& stream;
+    size_t size;
+    char buffer[TEXT_WRITER_BUFFER_SIZE];
+    
+    TextWriter(ostream& stream);
+    ~TextWriter();
+    void Write(const char* data, size_t length);
+    void Flush();
+    TextWriter& operator<<(const char* str);
+    TextWriter& operator<<(const string& str);
+    TextWriter& operator<<(char c);
+    TextWriter& operator<<(int value);
+};
+
+#endif
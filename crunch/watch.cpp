@@ -0,0 +1,185 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+
+#include "watch.hpp"
+#include "bitmap.hpp"
+#include "slice.hpp"
+#include "tinydir.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE)
+
+Watcher::Watcher()
+: fd(-1)
+{
+    
+}
+
+Watcher::~Watcher()
+{
+    if (fd >= 0)
+        close(fd);
+}
+
+void Watcher::AddDirectory(const string& path)
+{
+    //Without trailing slashes the paths of events match the ones tinydir gives the loader
+    string dir = path;
+    while (dir.size() > 1 && dir.back() == '/')
+        dir.pop_back();
+    int wd = inotify_add_watch(fd, dir.c_str(), WATCH_EVENTS);
+    if (wd < 0)
+        return;
+    dirs[wd] = dir;
+    
+    tinydir_dir tdir;
+    if (tinydir_open(&tdir, dir.c_str()) == -1)
+        return;
+    while (tdir.has_next)
+    {
+        tinydir_file file;
+        tinydir_readfile(&tdir, &file);
+        string name = file.name;
+        if (file.is_dir && name != "." && name != "..")
+            AddDirectory(file.path);
+        tinydir_next(&tdir);
+    }
+    tinydir_close(&tdir);
+}
+
+bool Watcher::Open(const vector<string>& roots)
+{
+    fd = inotify_init1(IN_CLOEXEC);
+    if (fd < 0)
+        return false;
+    for (const string& root : roots)
+        AddDirectory(root);
+    return !dirs.empty();
+}
+
+//Reads the pending events, and returns true if any of them touched an image, a sheet's
+//slices file or a directory
+bool Watcher::ReadEvents(vector<string>& changes)
+{
+    alignas(inotify_event) char buffer[4096];
+    bool changed = false;
+    ssize_t size = read(fd, buffer, sizeof(buffer));
+    for (ssize_t i = 0; i < size;)
+    {
+        const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + i);
+        i += sizeof(inotify_event) + event->len;
+        
+        auto it = dirs.find(event->wd);
+        if (it == dirs.end())
+            continue;
+        if (event->mask & IN_IGNORED)
+        {
+            changes.push_back(it->second);
+            dirs.erase(it);
+            changed = true;
+            continue;
+        }
+        
+        string name = event->len > 0 ? event->name : "";
+        string path = it->second + "/" + name;
+        if (event->mask & IN_ISDIR)
+        {
+            if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                AddDirectory(path);
+            changes.push_back(path);
+            changed = true;
+        }
+        else if (name.rfind('.') != string::npos && IsBitmapExtension(name.substr(name.rfind('.') + 1)))
+        {
+            changes.push_back(path);
+            changed = true;
+        }
+        else if (IsSliceFile(name))
+        {
+            changes.push_back(path);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool Watcher::Wait(int debounceMilliseconds, vector<string>& changes)
+{
+    pollfd pfd = { fd, POLLIN, 0 };
+    
+    //Block until something changes, then keep reading until the directories have been
+    //quiet for a while, so saving many files at once only triggers one rebuild
+    bool changed = false;
+    while (!changed)
+    {
+        if (poll(&pfd, 1, -1) < 0)
+            return false;
+        changed = ReadEvents(changes);
+    }
+    while (poll(&pfd, 1, debounceMilliseconds) > 0)
+        ReadEvents(changes);
+    return true;
+}
+
+#else
+
+Watcher::Watcher()
+: fd(-1)
+{
+    
+}
+
+Watcher::~Watcher()
+{
+    
+}
+
+void Watcher::AddDirectory(const string& dir)
+{
+    
+}
+
+bool Watcher::ReadEvents(vector<string>& changes)
+{
+    return false;
+}
+
+bool Watcher::Open(const vector<string>& roots)
+{
+    return false;
+}
+
+bool Watcher::Wait(int debounceMilliseconds, vector<string>& changes)
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,56 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ 
+ */
+
+
+#ifndef watch_hpp
+#define watch_hpp
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+using namespace std;
+
+//Waits for images to change in a set of directories and their subdirectories. Only
+//implemented with inotify on Linux, Open fails everywhere else. Wait adds the paths of
+//the files that changed to changes, and the path of every directory that was added,
+//removed or renamed, since everything under it may have changed.
+struct Watcher
+{
+    int fd;
+    unordered_map<int, string> dirs;
+    
+    Watcher();
+    ~Watcher();
+    bool Open(const vector<string>& roots);
+    bool Wait(int debounceMilliseconds, vector<string>& changes);
+    
+private:
+    void AddDirectory(const string& dir);
+    bool ReadEvents(vector<string>& changes);
+};
+
+#endif
@@ -0,0 +1,184 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ bench_atlas.cpp - name lookup benchmark for crunch_atlas.hpp
+ ============================================================
+ 
+ Packs an atlas of small sprites with libcrunch, then times looking every
+ sprite up by name through AtlasView's index, through a linear search of
+ the same records, and through an unordered_map for reference. Every
+ lookup is checked, so it fails if the index and the records disagree.
+ 
+    g++ -std=c++11 -O2 -pthread -Icrunch tools/bench_atlas.cpp libcrunch.a -o bench_atlas
+    ./bench_atlas [sprite count] [corpus dir]
+ 
+ Given a directory, it also saves the .bin and .soa there, as seeds for
+ fuzz_atlas.
+ */
+
+#include "crunch_atlas.hpp"
+#include "libcrunch.hpp"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdlib>
+
+using namespace std;
+
+#define BENCH_ROUNDS 20
+#define BENCH_LINEAR_LOOKUPS 2000
+
+static volatile uint64_t sink;
+
+//The views need 4 byte aligned data, like a memory mapping gives them
+static vector<uint32_t> Align(const vector<unsigned char>& buf)
+{
+    vector<uint32_t> aligned((buf.size() + 3) / 4);
+    copy(buf.begin(), buf.end(), reinterpret_cast<unsigned char*>(aligned.data()));
+    return aligned;
+}
+
+static bool Save(const string& file, const vector<unsigned char>& buf)
+{
+    ofstream stream(file, ios::binary);
+    stream.write(reinterpret_cast<const char*>(buf.data()), buf.size());
+    stream.close();
+    return !stream.fail();
+}
+
+//Runs lookup over every name, rounds times, and returns the nanoseconds per lookup
+template <typename F>
+static double Time(const vector<string>& names, size_t count, int rounds, F lookup)
+{
+    uint64_t sum = 0;
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r)
+        for (size_t i = 0; i < count; ++i)
+            sum += lookup(names[i]);
+    auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start);
+    sink = sum;
+    return double(elapsed.count()) / (double(count) * rounds);
+}
+
+int main(int argc, const char* argv[])
+{
+    int spriteCount = argc > 1 ? atoi(argv[1]) : 2000;
+    if (spriteCount <= 0)
+    {
+        cerr << "usage: bench_atlas [sprite count] [corpus dir]" << endl;
+        return EXIT_FAILURE;
+    }
+    
+    //Sprites of a few sizes with names like a game's, in nested directories
+    crunch::Atlas atlas((crunch::Options()));
+    mt19937 random(1);
+    vector<string> names;
+    vector<unsigned char> pixels;
+    for (int i = 0; i < spriteCount; ++i)
+    {
+        int w = 4 + random() % 13;
+        int h = 4 + random() % 13;
+        pixels.assign(size_t(w) * h * 4, static_cast<unsigned char>(random()));
+        names.push_back("characters/" + to_string(i % 97) + "/walk_" + to_string(i));
+        if (atlas.AddSprite(names.back(), pixels.data(), w, h) != crunch::RESULT_OK)
+        {
+            cerr << "failed to add sprite: " << names.back() << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    
+    vector<unsigned char> bin, soa;
+    if (atlas.Pack() != crunch::RESULT_OK || atlas.EncodeData(crunch::DATA_BINARY_V2, "bench", bin) != crunch::RESULT_OK ||
+        atlas.EncodeData(crunch::DATA_SOA, "bench", soa) != crunch::RESULT_OK)
+    {
+        cerr << "failed to pack the atlas" << endl;
+        return EXIT_FAILURE;
+    }
+    if (argc > 2 && (!Save(string(argv[2]) + "/bench.bin", bin) || !Save(string(argv[2]) + "/bench.soa", soa)))
+    {
+        cerr << "failed to save the atlas to: " << argv[2] << endl;
+        return EXIT_FAILURE;
+    }
+    
+    //The same file without its index, which makes Find search every record
+    vector<uint32_t> indexed = Align(bin);
+    vector<uint32_t> unindexed = indexed;
+    reinterpret_cast<crunch::AtlasHeader*>(unindexed.data())->hashSlots = 0;
+    crunch::AtlasView view, linear;
+    crunch::AtlasColumnsView columns;
+    vector<uint32_t> columnsData = Align(soa);
+    if (!view.Open(indexed.data(), bin.size()) || !linear.Open(unindexed.data(), bin.size()) || !columns.Open(columnsData.data(), soa.size()))
+    {
+        cerr << "failed to open the atlas" << endl;
+        return EXIT_FAILURE;
+    }
+    
+    unordered_map<string, size_t> map;
+    for (size_t i = 0; i < view.GetSpriteCount(); ++i)
+        map[view.GetName(view.GetSprite(i))] = i;
+    
+    //Every name must find its own record, and the columns must hold the same sprite
+    for (const string& name : names)
+    {
+        auto it = map.find(name);
+        const crunch::AtlasSprite* sprite = view.Find(name.c_str(), name.size());
+        if (it == map.end() || sprite != &view.GetSprite(it->second) || linear.Find(name.c_str(), name.size()) != &linear.GetSprite(it->second))
+        {
+            cerr << "lookup failed: " << name << endl;
+            return EXIT_FAILURE;
+        }
+        size_t index = it->second;
+        if (columns.GetX()[index] != sprite->x || columns.GetY()[index] != sprite->y)
+        {
+            cerr << "columns disagree with the records: " << name << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (view.Find("characters/missing") != nullptr)
+    {
+        cerr << "found a sprite that isn't in the atlas" << endl;
+        return EXIT_FAILURE;
+    }
+    
+    //Look names up in a different order than they were packed in
+    shuffle(names.begin(), names.end(), random);
+    size_t linearCount = min(names.size(), size_t(BENCH_LINEAR_LOOKUPS));
+    double indexTime = Time(names, names.size(), BENCH_ROUNDS, [&](const string& name) {
+        return view.Find(name.c_str(), name.size())->x;
+    });
+    double linearTime = Time(names, linearCount, 1, [&](const string& name) {
+        return linear.Find(name.c_str(), name.size())->x;
+    });
+    double mapTime = Time(names, names.size(), BENCH_ROUNDS, [&](const string& name) {
+        return view.GetSprite(map.find(name)->second).x;
+    });
+    
+    cout << spriteCount << " sprites, " << bin.size() << " byte .bin, " << soa.size() << " byte .soa" << endl;
+    cout << "index:         " << indexTime << " ns per lookup" << endl;
+    cout << "linear search: " << linearTime << " ns per lookup" << endl;
+    cout << "unordered_map: " << mapTime << " ns per lookup" << endl;
+    return EXIT_SUCCESS;
+}
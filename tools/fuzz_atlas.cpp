@@ -0,0 +1,117 @@
+/*
+ 
+ MIT License
+ 
+ Copyright (c) 2017 Chevy Ray Johnston
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ fuzz_atlas.cpp - libFuzzer target for crunch_atlas.hpp
+ ======================================================
+ 
+ Feeds arbitrary bytes to AtlasView and AtlasColumnsView and touches
+ everything a runtime would, so any read the Open() checks fail to cover
+ shows up under the sanitizers. Build and run it with clang:
+ 
+    clang++ -std=c++11 -g -O1 -fsanitize=fuzzer,address,undefined -Icrunch tools/fuzz_atlas.cpp -o fuzz_atlas
+    ./fuzz_atlas corpus/
+ 
+ bench_atlas writes valid atlases to seed the corpus with.
+ */
+
+#include "crunch_atlas.hpp"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+static volatile uint64_t sink;
+
+static void FuzzView(const unsigned char* data, size_t size)
+{
+    crunch::AtlasView atlas;
+    if (!atlas.Open(data, size))
+        return;
+    
+    uint64_t sum = atlas.GetFlags();
+    for (size_t i = 0; i < atlas.GetPageCount(); ++i)
+    {
+        const crunch::AtlasPage& page = atlas.GetPage(i);
+        sum += strlen(atlas.GetName(page)) + page.width + page.height;
+        for (const crunch::AtlasSprite& sprite : atlas.Sprites(page))
+            sum += sprite.page + sprite.x + sprite.y;
+    }
+    
+    //Every sprite should be found by its own name, unless the damaged index says otherwise
+    for (const crunch::AtlasSprite& sprite : atlas.Sprites())
+    {
+        const char* name = atlas.GetName(sprite);
+        const crunch::AtlasSprite* found = atlas.Find(name);
+        sum += strlen(name) + (found != nullptr ? found->flags : 0);
+    }
+    
+    //And names that aren't in the file should miss without reading outside of it
+    sum += atlas.Find("") != nullptr;
+    sum += atlas.Find(reinterpret_cast<const char*>(data), size < 64 ? size : 64) != nullptr;
+    sink = sum;
+}
+
+static void FuzzColumnsView(const unsigned char* data, size_t size)
+{
+    crunch::AtlasColumnsView columns;
+    if (!columns.Open(data, size))
+        return;
+    
+    uint64_t sum = 0;
+    const uint32_t* pageSizes = columns.GetPageSizes();
+    for (size_t i = 0; i < columns.GetPageCount() * 2; ++i)
+        sum += pageSizes[i];
+    
+    const uint32_t* pages = columns.GetPages();
+    const uint32_t* x = columns.GetX();
+    const uint32_t* y = columns.GetY();
+    const uint32_t* widths = columns.GetWidths();
+    const uint32_t* heights = columns.GetHeights();
+    const int32_t* frameX = columns.GetFrameX();
+    const int32_t* frameY = columns.GetFrameY();
+    const uint32_t* frameWidths = columns.GetFrameWidths();
+    const uint32_t* frameHeights = columns.GetFrameHeights();
+    const float* uvs = columns.GetUVs();
+    for (size_t i = 0; i < columns.GetSpriteCount(); ++i)
+    {
+        sum += pages[i] + x[i] + y[i] + widths[i] + heights[i] + uint32_t(frameX[i]) + uint32_t(frameY[i]) + frameWidths[i] + frameHeights[i];
+        sum += columns.IsRotated(i);
+        for (int j = 0; j < 8; ++j)
+            sum += uvs[i * 8 + j] > 0.5f;
+    }
+    sink = sum;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    //The views need 4 byte aligned data, like a memory mapping gives them
+    vector<uint32_t> aligned((size + 3) / 4);
+    if (size > 0)
+        memcpy(aligned.data(), data, size);
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(aligned.data());
+    
+    FuzzView(bytes, size);
+    FuzzColumnsView(bytes, size);
+    return 0;
+}